@@ -0,0 +1,58 @@
+# Builds chip8-headless in each variant and times it on roms/*.ch8, best of
+# RUNS per ROM, then reports the variant with the lowest total time. Run
+# through the benchmark target.
+include(${CMAKE_CURRENT_LIST_DIR}/variants.cmake)
+
+set(RUNS 3)
+set(FRAMES 500000)
+set(IPF 100)
+
+set(variants portable native lto lto-native pgo-lto-native)
+
+chip8_build_variant(portable)
+chip8_build_variant(native -DCHIP8_NATIVE=ON)
+chip8_build_variant(lto -DCHIP8_LTO=ON)
+chip8_build_variant(lto-native -DCHIP8_LTO=ON -DCHIP8_NATIVE=ON)
+chip8_build_pgo_variant(pgo-lto-native -DCHIP8_LTO=ON -DCHIP8_NATIVE=ON)
+
+# Wall time of one run in milliseconds, from chip8-headless's
+# "<n> s emulated in <t> s" report
+function(chip8_time_run headless rom out)
+    execute_process(
+        COMMAND ${headless} ${rom} --frames ${FRAMES} --ipf ${IPF} --seed 1
+        OUTPUT_VARIABLE report
+        RESULT_VARIABLE result)
+    if(result OR NOT report MATCHES "emulated in ([0-9]+)\\.([0-9][0-9][0-9]) s")
+        message(FATAL_ERROR "${headless} ${rom}: no timing in output")
+    endif()
+    math(EXPR ms "${CMAKE_MATCH_1} * 1000 + 1${CMAKE_MATCH_2} - 1000")
+    set(${out} ${ms} PARENT_SCOPE)
+endfunction()
+
+set(fastest "")
+foreach(variant ${variants})
+    set(total 0)
+    set(details "")
+
+    foreach(rom ${trainingRoms})
+        set(best "")
+        foreach(run RANGE 1 ${RUNS})
+            chip8_time_run(${${variant}_HEADLESS} ${rom} ms)
+            if(best STREQUAL "" OR ms LESS best)
+                set(best ${ms})
+            endif()
+        endforeach()
+
+        get_filename_component(romName ${rom} NAME_WE)
+        string(APPEND details " ${romName} ${best}")
+        math(EXPR total "${total} + ${best}")
+    endforeach()
+
+    message(STATUS "${variant}: ${total} ms (${details} )")
+    if(fastest STREQUAL "" OR total LESS fastestTotal)
+        set(fastest ${variant})
+        set(fastestTotal ${total})
+    endif()
+endforeach()
+
+message(STATUS "Fastest: ${fastest}, ${fastestTotal} ms for ${FRAMES} frames at ${IPF} ipf per ROM")
@@ -0,0 +1,15 @@
+# Profile-guided build of the core and tools in BINARY_DIR/pgo, trained on
+# roms/*.ch8 with chip8-headless. Run through the pgo target.
+include(${CMAKE_CURRENT_LIST_DIR}/variants.cmake)
+
+chip8_build_pgo_variant(pgo -DCHIP8_LTO=ON)
+
+execute_process(
+    COMMAND ${CMAKE_COMMAND} --build ${BINARY_DIR}/pgo --config Release
+    RESULT_VARIABLE result
+    OUTPUT_QUIET)
+if(result)
+    message(FATAL_ERROR "pgo: building the remaining targets failed")
+endif()
+
+message(STATUS "Profile-guided build in ${BINARY_DIR}/pgo")
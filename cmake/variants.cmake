@@ -0,0 +1,75 @@
+# Helpers for pgo.cmake and benchmark.cmake, which run in script mode with
+# SOURCE_DIR, BINARY_DIR, GENERATOR, CXX_COMPILER and CXX_COMPILER_ID set
+# by the top-level CMakeLists.txt.
+
+file(GLOB trainingRoms ${SOURCE_DIR}/roms/*.ch8)
+
+# Configures and builds chip8-headless in BINARY_DIR/<name> with the given
+# cache options; sets <name>_HEADLESS to the executable
+function(chip8_build_variant name)
+    set(dir ${BINARY_DIR}/${name})
+
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${dir} -G ${GENERATOR}
+            -DCMAKE_CXX_COMPILER=${CXX_COMPILER} -DCMAKE_BUILD_TYPE=Release -DCHIP8_SDL=OFF ${ARGN}
+        RESULT_VARIABLE result
+        OUTPUT_QUIET)
+    if(result)
+        message(FATAL_ERROR "${name}: configure failed")
+    endif()
+
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} --build ${dir} --target chip8-headless --config Release
+        RESULT_VARIABLE result
+        OUTPUT_QUIET)
+    if(result)
+        message(FATAL_ERROR "${name}: build failed")
+    endif()
+
+    # Multi-config generators put it under the configuration
+    foreach(candidate ${dir}/chip8-headless ${dir}/chip8-headless.exe
+                      ${dir}/Release/chip8-headless ${dir}/Release/chip8-headless.exe)
+        if(EXISTS ${candidate} AND NOT IS_DIRECTORY ${candidate})
+            set(${name}_HEADLESS ${candidate} PARENT_SCOPE)
+            return()
+        endif()
+    endforeach()
+    message(FATAL_ERROR "${name}: chip8-headless not found in ${dir}")
+endfunction()
+
+# Instrumented build, training on every ROM with both timing models, then
+# the same build directory rebuilt with the profile. GCC names its profile
+# files after the object paths, so the directory must not change between
+# the two builds.
+function(chip8_build_pgo_variant name)
+    set(profileDir ${BINARY_DIR}/${name}/profile)
+    file(REMOVE_RECURSE ${profileDir})
+
+    chip8_build_variant(${name} ${ARGN} -DCHIP8_PGO=GENERATE -DCHIP8_PGO_DIR=${profileDir})
+
+    foreach(rom ${trainingRoms})
+        foreach(timing fast vip)
+            execute_process(
+                COMMAND ${${name}_HEADLESS} ${rom} --frames 3000 --timing ${timing} --seed 1
+                RESULT_VARIABLE result
+                OUTPUT_QUIET ERROR_QUIET)
+            if(result)
+                message(FATAL_ERROR "${name}: training run on ${rom} failed")
+            endif()
+        endforeach()
+    endforeach()
+
+    if(CXX_COMPILER_ID MATCHES "Clang")
+        find_program(profdata NAMES llvm-profdata REQUIRED)
+        file(GLOB raw ${profileDir}/*.profraw)
+        execute_process(
+            COMMAND ${profdata} merge -output=${profileDir}/default.profdata ${raw}
+            RESULT_VARIABLE result)
+        if(result)
+            message(FATAL_ERROR "${name}: llvm-profdata merge failed")
+        endif()
+    endif()
+
+    chip8_build_variant(${name} ${ARGN} -DCHIP8_PGO=USE -DCHIP8_PGO_DIR=${profileDir})
+    set(${name}_HEADLESS ${${name}_HEADLESS} PARENT_SCOPE)
+endfunction()
@@ -0,0 +1,362 @@
+// chip8_libretro: libretro core around the CHIP8 engine
+//
+// Build with 'make libretro LIBRETRO_DIR=<dir holding libretro.h>'. One
+// retro_run is one 60 Hz frame of the "chip8_ipf" core option's
+// instructions; the quirk profile follows the ROM's extension unless the
+// "chip8_quirks" option names one. Save states are CHIP8::SaveState images.
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include <libretro.h>
+
+#include "chip8.h"
+#include "timing.h"
+
+static constexpr int SAMPLE_RATE = 48000;
+static constexpr int SAMPLES_PER_FRAME = SAMPLE_RATE / 60;
+static constexpr unsigned int DEFAULT_CYCLES_PER_FRAME = 15;
+
+// Colour per (plane 1, plane 0) bit pair, as the SDL frontend draws them
+static const uint32_t palette[4] = { 0x000000, 0xFFFFFF, 0xAAAAAA, 0x555555 };
+
+static retro_environment_t environment;
+static retro_video_refresh_t videoRefresh;
+static retro_audio_sample_batch_t audioBatch;
+static retro_input_poll_t inputPoll;
+static retro_input_state_t inputState;
+
+static std::unique_ptr<CHIP8> chip8;
+static std::unique_ptr<uint8_t[]> rom;
+static size_t romSize;
+static bool xoRom;
+
+static unsigned int cyclesPerFrame = DEFAULT_CYCLES_PER_FRAME;
+static bool forcedQuirks;
+static QuirkProfile quirks;
+
+static bool canDupe;
+static bool redraw;                 // next retro_run presents even without a draw
+static uint32_t pixels[CHIP8::HIRES_WIDTH * CHIP8::HIRES_HEIGHT];
+
+// Pattern bits per sample for each pitch register value, as a 32-bit
+// phase whose top 7 bits index the 128 pattern bits, like Audio
+static uint32_t pitchStep[256];
+static uint32_t phase;
+static int16_t samples[SAMPLES_PER_FRAME * 2];
+
+// RetroPad binding mirrors KeyMap's gamepad defaults
+static const struct { unsigned int id; uint8_t key; } padKeys[] = {
+    { RETRO_DEVICE_ID_JOYPAD_UP, 0x5 },
+    { RETRO_DEVICE_ID_JOYPAD_LEFT, 0x7 },
+    { RETRO_DEVICE_ID_JOYPAD_DOWN, 0x8 },
+    { RETRO_DEVICE_ID_JOYPAD_RIGHT, 0x9 },
+    { RETRO_DEVICE_ID_JOYPAD_B, 0x6 },
+    { RETRO_DEVICE_ID_JOYPAD_A, 0x4 },
+    { RETRO_DEVICE_ID_JOYPAD_Y, 0xA },
+    { RETRO_DEVICE_ID_JOYPAD_X, 0xB },
+    { RETRO_DEVICE_ID_JOYPAD_START, 0xF },
+};
+
+// Keyboard: the 1234/QWER/ASDF/ZXCV block, indexed by CHIP-8 key
+static const unsigned int keyboardKeys[16] = {
+    RETROK_x, RETROK_1, RETROK_2, RETROK_3,
+    RETROK_q, RETROK_w, RETROK_e, RETROK_a,
+    RETROK_s, RETROK_d, RETROK_z, RETROK_c,
+    RETROK_4, RETROK_r, RETROK_f, RETROK_v
+};
+
+static const retro_variable variables[] = {
+    { "chip8_ipf", "Instructions per frame; 15|7|10|20|30|50|100|200|500|1000" },
+    { "chip8_quirks", "Quirk profile; auto|vip|chip48|schip|xochip" },
+    { nullptr, nullptr },
+};
+
+static void ReadVariables()
+{
+    retro_variable variable{ "chip8_ipf", nullptr };
+    if (environment(RETRO_ENVIRONMENT_GET_VARIABLE, &variable) && variable.value)
+    {
+        int value = std::atoi(variable.value);
+        cyclesPerFrame = value > 0 ? (unsigned int)value : DEFAULT_CYCLES_PER_FRAME;
+    }
+
+    variable = { "chip8_quirks", nullptr };
+    if (environment(RETRO_ENVIRONMENT_GET_VARIABLE, &variable) && variable.value)
+    {
+        forcedQuirks = ParseQuirkProfile(variable.value, quirks);
+    }
+}
+
+static QuirkProfile RomQuirks()
+{
+    if (forcedQuirks)
+    {
+        return quirks;
+    }
+    return xoRom ? QuirkProfile::XOChip : QuirkProfile::SuperChip;
+}
+
+static bool StartRom()
+{
+    chip8.reset(new CHIP8);
+    phase = 0;
+    redraw = true;
+    return chip8->loadROM(rom.get(), romSize, nullptr, RomQuirks());
+}
+
+// Composites the packed planes straight into the destination, normally
+// the frontend's own framebuffer
+static void ExpandFrame(uint32_t* destination, size_t pitch)
+{
+    for (unsigned int y = 0; y < chip8->Height(); ++y)
+    {
+        uint32_t* out = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(destination) + y * pitch);
+        uint64_t const* plane0 = chip8->video[0][y];
+        uint64_t const* plane1 = chip8->video[1][y];
+
+        for (unsigned int x = 0; x < chip8->Width(); ++x)
+        {
+            unsigned int shift = 63 - (x & 63);
+            unsigned int colour = ((plane0[x >> 6] >> shift) & 1u) | (((plane1[x >> 6] >> shift) & 1u) << 1);
+            out[x] = palette[colour];
+        }
+    }
+}
+
+static void PresentFrame()
+{
+    unsigned int width = chip8->Width(), height = chip8->Height();
+
+    // Frames without a draw are dupes, nothing is composited
+    if (!chip8->drawFlag && !redraw && canDupe)
+    {
+        videoRefresh(nullptr, width, height, 0);
+        return;
+    }
+    chip8->drawFlag = false;
+    redraw = false;
+
+    retro_framebuffer framebuffer{};
+    framebuffer.width = width;
+    framebuffer.height = height;
+    framebuffer.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+
+    if (environment(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, &framebuffer)
+        && framebuffer.data && framebuffer.format == RETRO_PIXEL_FORMAT_XRGB8888)
+    {
+        ExpandFrame(static_cast<uint32_t*>(framebuffer.data), framebuffer.pitch);
+        videoRefresh(framebuffer.data, width, height, framebuffer.pitch);
+        return;
+    }
+
+    ExpandFrame(pixels, width * sizeof(uint32_t));
+    videoRefresh(pixels, width, height, width * sizeof(uint32_t));
+}
+
+// Square wave from the sound timer, or the XO-CHIP pattern at its pitch
+static void QueueAudio()
+{
+    if (chip8->soundTimer == 0)
+    {
+        std::memset(samples, 0, sizeof(samples));
+    }
+    else
+    {
+        uint32_t step = pitchStep[chip8->pitch];
+
+        for (int i = 0; i < SAMPLES_PER_FRAME; ++i)
+        {
+            uint32_t bit = phase >> 25;
+            int16_t sample = ((chip8->pattern[bit >> 3] >> (7 - (bit & 7))) & 1u) ? 8192 : -8192;
+            samples[2 * i] = samples[2 * i + 1] = sample;
+            phase += step;
+        }
+    }
+    audioBatch(samples, SAMPLES_PER_FRAME);
+}
+
+static void ReadInput()
+{
+    inputPoll();
+
+    uint16_t keys = 0;
+    for (auto const& binding : padKeys)
+    {
+        if (inputState(0, RETRO_DEVICE_JOYPAD, 0, binding.id))
+        {
+            keys |= 1u << binding.key;
+        }
+    }
+    for (unsigned int key = 0; key < 16; ++key)
+    {
+        if (inputState(0, RETRO_DEVICE_KEYBOARD, 0, keyboardKeys[key]))
+        {
+            keys |= 1u << key;
+        }
+    }
+
+    for (unsigned int key = 0; key < 16; ++key)
+    {
+        chip8->keypad[key] = (keys >> key) & 1u;
+    }
+}
+
+RETRO_API unsigned retro_api_version(void)
+{
+    return RETRO_API_VERSION;
+}
+
+RETRO_API void retro_set_environment(retro_environment_t callback)
+{
+    environment = callback;
+    environment(RETRO_ENVIRONMENT_SET_VARIABLES, const_cast<retro_variable*>(variables));
+}
+
+RETRO_API void retro_set_video_refresh(retro_video_refresh_t callback) { videoRefresh = callback; }
+RETRO_API void retro_set_audio_sample(retro_audio_sample_t) {}
+RETRO_API void retro_set_audio_sample_batch(retro_audio_sample_batch_t callback) { audioBatch = callback; }
+RETRO_API void retro_set_input_poll(retro_input_poll_t callback) { inputPoll = callback; }
+RETRO_API void retro_set_input_state(retro_input_state_t callback) { inputState = callback; }
+
+RETRO_API void retro_init(void)
+{
+    // XO-CHIP: 4000 * 2^((pitch - 64) / 48) pattern bits per second
+    for (int pitch = 0; pitch < 256; ++pitch)
+    {
+        double bitsPerSecond = 4000.0 * std::pow(2.0, (pitch - 64) / 48.0);
+        pitchStep[pitch] = (uint32_t)(bitsPerSecond / SAMPLE_RATE * (1u << 25));
+    }
+}
+
+RETRO_API void retro_deinit(void)
+{
+    chip8.reset();
+    rom.reset();
+}
+
+RETRO_API void retro_get_system_info(retro_system_info* info)
+{
+    std::memset(info, 0, sizeof(*info));
+    info->library_name = "CHIP-8";
+    info->library_version = "1.0";
+    info->valid_extensions = "ch8|sc8|xo8";
+    info->need_fullpath = false;
+    info->block_extract = false;
+}
+
+RETRO_API void retro_get_system_av_info(retro_system_av_info* info)
+{
+    std::memset(info, 0, sizeof(*info));
+    info->geometry.base_width = CHIP8::VIDEO_WIDTH;
+    info->geometry.base_height = CHIP8::VIDEO_HEIGHT;
+    info->geometry.max_width = CHIP8::HIRES_WIDTH;
+    info->geometry.max_height = CHIP8::HIRES_HEIGHT;
+    info->geometry.aspect_ratio = 2.0f;
+    info->timing.fps = 60.0;
+    info->timing.sample_rate = SAMPLE_RATE;
+}
+
+RETRO_API void retro_set_controller_port_device(unsigned, unsigned) {}
+
+RETRO_API void retro_reset(void)
+{
+    StartRom();
+}
+
+RETRO_API void retro_run(void)
+{
+    bool updated = false;
+    if (environment(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated) && updated)
+    {
+        QuirkProfile previous = RomQuirks();
+        ReadVariables();
+        if (RomQuirks() != previous)
+        {
+            chip8->SetQuirks(RomQuirks());
+        }
+    }
+
+    ReadInput();
+    chip8->RunFrame<FastTiming>(cyclesPerFrame);
+    PresentFrame();
+    QueueAudio();
+}
+
+RETRO_API size_t retro_serialize_size(void)
+{
+    return CHIP8::StateSize();
+}
+
+RETRO_API bool retro_serialize(void* data, size_t size)
+{
+    return chip8 && chip8->SaveState(static_cast<uint8_t*>(data), size);
+}
+
+RETRO_API bool retro_unserialize(void const* data, size_t size)
+{
+    if (!chip8 || !chip8->LoadState(static_cast<uint8_t const*>(data), size))
+    {
+        return false;
+    }
+    redraw = true;
+    return true;
+}
+
+RETRO_API void retro_cheat_reset(void) {}
+RETRO_API void retro_cheat_set(unsigned, bool, char const*) {}
+
+RETRO_API bool retro_load_game(retro_game_info const* game)
+{
+    if (!game || !game->data || game->size > sizeof(CHIP8::memory) - CHIP8::START_ADDRESS)
+    {
+        return false;
+    }
+
+    retro_pixel_format format = RETRO_PIXEL_FORMAT_XRGB8888;
+    if (!environment(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &format))
+    {
+        return false;
+    }
+    canDupe = false;
+    environment(RETRO_ENVIRONMENT_GET_CAN_DUPE, &canDupe);
+
+    // The frontend may free its copy after this returns
+    rom.reset(new uint8_t[game->size]);
+    std::memcpy(rom.get(), game->data, game->size);
+    romSize = game->size;
+
+    char const* extension = game->path ? std::strrchr(game->path, '.') : nullptr;
+    xoRom = extension && std::strcmp(extension, ".xo8") == 0;
+
+    ReadVariables();
+    return StartRom();
+}
+
+RETRO_API bool retro_load_game_special(unsigned, retro_game_info const*, size_t)
+{
+    return false;
+}
+
+RETRO_API void retro_unload_game(void)
+{
+    chip8.reset();
+    rom.reset();
+}
+
+RETRO_API unsigned retro_get_region(void)
+{
+    return RETRO_REGION_NTSC;
+}
+
+RETRO_API void* retro_get_memory_data(unsigned id)
+{
+    return id == RETRO_MEMORY_SYSTEM_RAM && chip8 ? chip8->memory : nullptr;
+}
+
+RETRO_API size_t retro_get_memory_size(unsigned id)
+{
+    return id == RETRO_MEMORY_SYSTEM_RAM && chip8 ? sizeof(chip8->memory) : 0;
+}
@@ -0,0 +1,107 @@
+#include "audio.h"
+#include <cmath>
+
+
+Audio::Audio()
+{
+    // XO-CHIP: 4000 * 2^((pitch - 64) / 48) pattern bits per second
+    for (int pitch = 0; pitch < 256; ++pitch)
+    {
+        double bitsPerSecond = 4000.0 * std::pow(2.0, (pitch - 64) / 48.0);
+        pitchStep[pitch] = (uint32_t)(bitsPerSecond / SAMPLE_RATE * (1u << 25));
+    }
+
+    // Two frames of silence up front absorb scheduling jitter
+    ring.Push(silentFrame, SAMPLES_PER_FRAME);
+    ring.Push(silentFrame, SAMPLES_PER_FRAME);
+
+    SDL_InitSubSystem(SDL_INIT_AUDIO);
+
+    SDL_AudioSpec spec{SDL_AUDIO_F32, 1, SAMPLE_RATE};
+    stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, &Audio::Callback, this);
+    if (stream)
+    {
+        SDL_ResumeAudioStreamDevice(stream);
+    }
+    else
+    {
+        SDL_Log("Audio disabled: %s", SDL_GetError());
+    }
+}
+
+Audio::~Audio()
+{
+    if (stream)
+    {
+        SDL_DestroyAudioStream(stream);
+        SDL_Log("Audio underruns: %llu, overruns: %llu frames",
+            (unsigned long long)Underruns(), (unsigned long long)Overruns());
+    }
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
+
+void Audio::QueueFrame(bool sounding, uint8_t const* pattern, uint8_t pitch)
+{
+    // The pattern phase still advances over a dropped frame
+    bool fits = ring.Space() >= SAMPLES_PER_FRAME;
+    if (!fits)
+    {
+        overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (!sounding)
+    {
+        if (fits)
+        {
+            ring.Push(silentFrame, SAMPLES_PER_FRAME);
+        }
+        return;
+    }
+
+    // Fixed cost per frame: one table lookup for the step, then a shift
+    // and mask per sample to pick the pattern bit
+    float frame[SAMPLES_PER_FRAME];
+    uint32_t step = pitchStep[pitch];
+
+    for (int i = 0; i < SAMPLES_PER_FRAME; ++i)
+    {
+        uint32_t bit = phase >> 25;
+        frame[i] = ((pattern[bit >> 3] >> (7 - (bit & 7))) & 1u) ? 0.25f : -0.25f;
+        phase += step;
+    }
+
+    if (fits)
+    {
+        ring.Push(frame, SAMPLES_PER_FRAME);
+    }
+}
+
+// Runs on SDL's audio thread: fixed stack buffer, no allocation, no locks
+void SDLCALL Audio::Callback(void* userdata, SDL_AudioStream* stream,
+    int additionalAmount, int /*totalAmount*/)
+{
+    Audio* audio = static_cast<Audio*>(userdata);
+    float buffer[256];
+    int needed = additionalAmount / (int)sizeof(float);
+    bool starved = false;
+
+    while (needed > 0)
+    {
+        size_t count = needed < 256 ? needed : 256;
+        size_t got = audio->ring.Pop(buffer, count);
+
+        for (size_t i = got; i < count; ++i)
+        {
+            buffer[i] = 0.0f;
+            starved = true;
+        }
+
+        SDL_PutAudioStreamData(stream, buffer, (int)(count * sizeof(float)));
+        needed -= (int)count;
+    }
+
+    if (starved)
+    {
+        audio->underruns.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,48 @@
+// audio.h
+#include <SDL3/SDL.h>
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "spsc_queue.h"
+
+// Sound output for the sound timer and the XO-CHIP pattern buffer. The
+// emulator renders one 60 Hz frame of samples at a time into a lock-free
+// ring; SDL's audio callback only drains that ring, so it never
+// allocates, locks or waits on emulation.
+class Audio
+{
+    public:
+        static constexpr int SAMPLE_RATE = 48000;
+        static constexpr int SAMPLES_PER_FRAME = SAMPLE_RATE / 60;
+
+        Audio();
+        ~Audio();
+
+        // Producer side, called once per emulated frame. Plays the 128-bit
+        // pattern (MSB first) at the XO-CHIP pitch while sounding. A frame
+        // the ring has no room for is dropped whole, so what is queued stays
+        // in step with emulation.
+        void QueueFrame(bool sounding, uint8_t const* pattern, uint8_t pitch);
+
+        uint64_t Underruns() const { return underruns.load(std::memory_order_relaxed); }
+        uint64_t Overruns() const { return overruns.load(std::memory_order_relaxed); }
+
+    private:
+        static void SDLCALL Callback(void* userdata, SDL_AudioStream* stream,
+            int additionalAmount, int totalAmount);
+
+        SDL_AudioStream* stream{};
+
+        // Pattern position per host sample for each pitch register value,
+        // as a 32-bit phase whose top 7 bits index the 128 pattern bits
+        uint32_t pitchStep[256]{};
+        uint32_t phase{};
+
+        float silentFrame[SAMPLES_PER_FRAME]{};
+
+        SPSCQueue<float, 8192> ring; // ~170 ms at 48 kHz
+        std::atomic<uint64_t> underruns{};
+        std::atomic<uint64_t> overruns{};   // frames dropped on a full ring
+};
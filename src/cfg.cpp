@@ -0,0 +1,273 @@
+#include "cfg.h"
+#include <algorithm>
+#include <cstdio>
+
+
+// Instructions after which execution does not simply fall through
+static bool EndsBlock(OpId id)
+{
+    switch (id)
+    {
+        case OpId::Op1nnn:
+        case OpId::Op2nnn:
+        case OpId::Op00EE:
+        case OpId::Op00FD:
+        case OpId::OpBnnn:
+        case OpId::Invalid:
+            return true;
+        default:
+            return IsSkip(id);
+    }
+}
+
+void ControlFlowGraph::Build(uint8_t const* memory, size_t romEnd, uint16_t entry)
+{
+    this->memory = memory;
+    this->romEnd = romEnd;
+    this->entry = entry;
+
+    code.reset();
+    starts.reset();
+    leaders.reset();
+    blocks.clear();
+    idleLoops.clear();
+
+    // Pass 1: every reachable instruction and the addresses blocks start at
+    std::vector<uint16_t> work{entry};
+    leaders[entry] = true;
+
+    while (!work.empty())
+    {
+        uint16_t address = work.back();
+        work.pop_back();
+
+        while (!starts[address])
+        {
+            uint16_t opcode = Opcode(address);
+            OpId id = Decode(opcode);
+            uint16_t next = (address + InstructionLength(id)) & 0xFFFFu;
+
+            starts[address] = true;
+            for (uint16_t byte = address; byte != next; byte = (byte + 1) & 0xFFFFu)
+            {
+                code[byte] = true;
+            }
+
+            // Branch targets start blocks; so does the instruction after a
+            // call or skip, since something else also reaches it
+            if (id == OpId::Op1nnn || id == OpId::Op2nnn)
+            {
+                uint16_t target = opcode & 0x0FFFu;
+                leaders[target] = true;
+                work.push_back(target);
+            }
+            if (id == OpId::Op2nnn || IsSkip(id))
+            {
+                leaders[next] = true;
+            }
+            if (IsSkip(id))
+            {
+                uint16_t skipped = Next(next);
+                leaders[skipped] = true;
+                work.push_back(skipped);
+            }
+
+            if (id == OpId::Op1nnn || id == OpId::Op00EE || id == OpId::Op00FD
+                || id == OpId::OpBnnn || id == OpId::Invalid)
+            {
+                break;
+            }
+            address = next;
+        }
+    }
+
+    // Pass 2: cut the instruction stream into blocks at leaders and at
+    // control transfers
+    for (uint32_t start = 0; start <= 0xFFFF; ++start)
+    {
+        if (!leaders[start] || !starts[start])
+        {
+            continue;
+        }
+
+        BasicBlock block{(uint16_t)start, 0, {}, false};
+        uint16_t address = (uint16_t)start;
+
+        for (;;)
+        {
+            uint16_t opcode = Opcode(address);
+            OpId id = Decode(opcode);
+            uint16_t next = Next(address);
+
+            if (EndsBlock(id))
+            {
+                block.end = next;
+
+                if (id == OpId::Op1nnn || id == OpId::Op2nnn)
+                {
+                    block.successors.push_back(opcode & 0x0FFFu);
+                }
+                if (id == OpId::Op2nnn || IsSkip(id))
+                {
+                    block.successors.push_back(next);
+                }
+                if (IsSkip(id))
+                {
+                    block.successors.push_back(Next(next));
+                }
+                block.indirect = id == OpId::OpBnnn;
+                break;
+            }
+
+            if (leaders[next] || !starts[next])
+            {
+                block.end = next;
+                block.successors.push_back(next);
+                break;
+            }
+            address = next;
+        }
+
+        blocks.push_back(block);
+    }
+
+    FindIdleLoops();
+}
+
+// A backward 1nnn whose body, walked straight through, is nothing but
+// timer reads and skips
+void ControlFlowGraph::FindIdleLoops()
+{
+    for (BasicBlock const& block : blocks)
+    {
+        uint16_t jump = block.end - 2;
+        uint16_t opcode = Opcode(jump);
+
+        if (Decode(opcode) != OpId::Op1nnn || (opcode & 0x0FFFu) > jump)
+        {
+            continue;
+        }
+
+        uint16_t address = opcode & 0x0FFFu;
+        bool idle = true;
+
+        while (idle && address != jump)
+        {
+            OpId id = Decode(Opcode(address));
+            idle = starts[address] && (IsSkip(id) || id == OpId::OpFx07);
+            address = Next(address);
+
+            // Walked past the jump: the body is not a straight line
+            idle = idle && address <= jump;
+        }
+
+        if (idle)
+        {
+            idleLoops.push_back({(uint16_t)(opcode & 0x0FFFu), block.end});
+        }
+    }
+
+    std::sort(idleLoops.begin(), idleLoops.end(),
+        [](IdleLoop const& a, IdleLoop const& b) { return a.start < b.start; });
+}
+
+BasicBlock const* ControlFlowGraph::FindBlock(uint16_t address) const
+{
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), address,
+        [](uint16_t value, BasicBlock const& block) { return value < block.start; });
+
+    if (it == blocks.begin() || address >= (it - 1)->end)
+    {
+        return nullptr;
+    }
+    return &*(it - 1);
+}
+
+IdleLoop const* ControlFlowGraph::FindIdleLoop(uint16_t address) const
+{
+    for (IdleLoop const& loop : idleLoops)
+    {
+        if (address >= loop.start && address < loop.end)
+        {
+            return &loop;
+        }
+    }
+    return nullptr;
+}
+
+static std::string Hex(unsigned int value)
+{
+    char text[8];
+    std::snprintf(text, sizeof(text), "%03X", value);
+    return text;
+}
+
+void ControlFlowGraph::WriteDot(std::ostream& out) const
+{
+    out << "digraph cfg {\n"
+        << "    node [shape=box fontname=monospace];\n";
+
+    for (BasicBlock const& block : blocks)
+    {
+        out << "    b" << Hex(block.start) << " [label=\"";
+        for (uint16_t address = block.start; address < block.end; address = Next(address))
+        {
+            out << Hex(address) << "  " << Disassemble(Opcode(address), Opcode(address + 2)) << "\\l";
+        }
+        out << "\"";
+        if (FindIdleLoop(block.start))
+        {
+            out << " style=dashed";
+        }
+        out << "];\n";
+
+        for (uint16_t successor : block.successors)
+        {
+            out << "    b" << Hex(block.start) << " -> b" << Hex(successor) << ";\n";
+        }
+    }
+    out << "}\n";
+}
+
+void ControlFlowGraph::WriteJson(std::ostream& out) const
+{
+    out << "{\n  \"entry\": " << entry << ",\n  \"blocks\": [";
+
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        BasicBlock const& block = blocks[i];
+        out << (i ? ",\n" : "\n") << "    {\"start\": " << block.start << ", \"end\": " << block.end
+            << ", \"indirect\": " << (block.indirect ? "true" : "false") << ", \"successors\": [";
+        for (size_t j = 0; j < block.successors.size(); ++j)
+        {
+            out << (j ? ", " : "") << block.successors[j];
+        }
+        out << "]}";
+    }
+
+    out << "\n  ],\n  \"idleLoops\": [";
+    for (size_t i = 0; i < idleLoops.size(); ++i)
+    {
+        out << (i ? ", " : "") << "{\"start\": " << idleLoops[i].start << ", \"end\": " << idleLoops[i].end << "}";
+    }
+
+    // Data as [start, end) ranges of unreached ROM bytes
+    out << "],\n  \"data\": [";
+    bool first = true;
+    for (size_t address = entry; address < romEnd; )
+    {
+        if (code[address])
+        {
+            ++address;
+            continue;
+        }
+        size_t start = address;
+        while (address < romEnd && !code[address])
+        {
+            ++address;
+        }
+        out << (first ? "" : ", ") << "[" << start << ", " << address << "]";
+        first = false;
+    }
+    out << "]\n}\n";
+}
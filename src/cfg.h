@@ -0,0 +1,74 @@
+// cfg.h
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "decode.h"
+
+// Straight-line run of instructions entered only at start
+struct BasicBlock
+{
+    uint16_t start;
+    uint16_t end;                       // one past the last instruction byte
+    std::vector<uint16_t> successors;   // skips and 2nnn have two
+    bool indirect;                      // ends in Bnnn, successors unknown
+};
+
+// Loop that only polls timers or keys and jumps back, e.g.
+//   loop: LD V0, DT / SE V0, 0 / JP loop
+// Until a timer tick or key event nothing it reads can change, so a core
+// may fast-forward to the next frame once Pc enters it.
+struct IdleLoop
+{
+    uint16_t start;
+    uint16_t end;                       // one past the closing 1nnn
+};
+
+// Static control-flow graph recovered by following 1nnn, 2nnn and skip
+// edges from the entry point, using Decode for instruction lengths and kinds.
+// Bytes never reached are treated as data. Bnnn targets and self-modifying
+// code are invisible to it, so the graph under-approximates the code.
+class ControlFlowGraph
+{
+    public:
+        // memory must stay valid while the graph is used; romEnd bounds
+        // the range reported as data
+        void Build(uint8_t const* memory, size_t romEnd, uint16_t entry = 0x200);
+
+        bool IsCode(uint16_t address) const { return code[address]; }
+        bool IsInstruction(uint16_t address) const { return starts[address]; }
+
+        BasicBlock const* FindBlock(uint16_t address) const;
+        IdleLoop const* FindIdleLoop(uint16_t address) const;
+
+        void WriteDot(std::ostream& out) const;
+        void WriteJson(std::ostream& out) const;
+
+        std::vector<BasicBlock> blocks;     // sorted by start
+        std::vector<IdleLoop> idleLoops;    // sorted by start
+
+    private:
+        uint16_t Opcode(uint16_t address) const
+        {
+            return (memory[address] << 8u) | memory[(address + 1) & 0xFFFFu];
+        }
+
+        uint16_t Next(uint16_t address) const
+        {
+            return (address + InstructionLength(Decode(Opcode(address)))) & 0xFFFFu;
+        }
+
+        void FindIdleLoops();
+
+        uint8_t const* memory{};
+        size_t romEnd{};
+        uint16_t entry{};
+
+        std::bitset<65536> code;        // every byte of a reachable instruction
+        std::bitset<65536> starts;      // first byte of a reachable instruction
+        std::bitset<65536> leaders;     // block starts
+};
@@ -1,16 +1,17 @@
 #include "chip8.h"
+#include "timing.h"
 #include <fstream>
 #include <vector>
 #include <algorithm>
 #include <iostream>
+#include <cstring>
+#include <type_traits>
 
 
 
 
 
 CHIP8::CHIP8() : randGen(std::chrono::system_clock::now().time_since_epoch().count()){
-    
-    randByte = std::uniform_int_distribution<uint8_t>(0, 255U);
 
     Pc = START_ADDRESS;
 
@@ -39,70 +40,214 @@ CHIP8::CHIP8() : randGen(std::chrono::system_clock::now().time_since_epoch().cou
         memory[FONTSET_START_ADDRESS + i] = fontset[i];
     }
 
+    // SUPER-CHIP 8x10 digits, A-F as drawn by XO-CHIP interpreters
+    uint8_t tempBigFontset[BIGFONT_SIZE] = {
+        0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+        0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+        0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+        0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+        0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+        0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+        0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+        0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+    };
+
+    for (unsigned int i = 0; i < BIGFONT_SIZE; ++i)
+    {
+        bigFontset[i] = tempBigFontset[i];
+        memory[BIGFONT_START_ADDRESS + i] = bigFontset[i];
+    }
+
+    // Default pattern is a 50% square wave, 500 Hz at the default pitch,
+    // so plain CHIP-8 ROMs get the classic beep
+    std::fill(std::begin(pattern), std::end(pattern), 0xF0);
+
 
     table[0x0] = &CHIP8::Table0;
     table[0x1] = &CHIP8::OP_1nnn;
     table[0x2] = &CHIP8::OP_2nnn;
     table[0x3] = &CHIP8::OP_3xkk;
     table[0x4] = &CHIP8::OP_4xkk;
-    table[0x5] = &CHIP8::OP_5xy0;
+    table[0x5] = &CHIP8::Table5;
     table[0x6] = &CHIP8::OP_6xkk;
     table[0x7] = &CHIP8::OP_7xkk;
     table[0x8] = &CHIP8::Table8;
     table[0x9] = &CHIP8::OP_9xy0;
     table[0xA] = &CHIP8::OP_Annn;
-    table[0xB] = &CHIP8::OP_Bnnn;
     table[0xC] = &CHIP8::OP_Cxkk;
-    table[0xD] = &CHIP8::OP_Dxyn;
     table[0xE] = &CHIP8::TableE;
     table[0xF] = &CHIP8::TableF;
 
     // avoid garbage
-    for (size_t i = 0; i <= 0xE; i++)
+    for (size_t i = 0; i <= 0xF; i++)
     {
-        table0[i] = &CHIP8::OP_NULL;
+        table5[i] = &CHIP8::OP_NULL;
         table8[i] = &CHIP8::OP_NULL;
         tableE[i] = &CHIP8::OP_NULL;
     }
 
-    table0[0x0] = &CHIP8::OP_00E0;
-    table0[0xE] = &CHIP8::OP_00EE;
+    table5[0x0] = &CHIP8::OP_5xy0;
+    table5[0x2] = &CHIP8::OP_5xy2;
+    table5[0x3] = &CHIP8::OP_5xy3;
+
+    // 00kk decodes on the whole low byte (SUPER-CHIP 00FE vs 00EE)
+    for (size_t i = 0; i <= 0xFF; i++)
+    {
+        table0[i] = &CHIP8::OP_NULL;
+    }
+
+    table0[0xE0] = &CHIP8::OP_00E0;
+    table0[0xEE] = &CHIP8::OP_00EE;
+    for (size_t n = 0; n <= 0xF; n++)
+    {
+        table0[0xC0 + n] = &CHIP8::OP_00Cn;
+    }
+    table0[0xFB] = &CHIP8::OP_00FB;
+    table0[0xFC] = &CHIP8::OP_00FC;
+    table0[0xFD] = &CHIP8::OP_00FD;
+    table0[0xFE] = &CHIP8::OP_00FE;
+    table0[0xFF] = &CHIP8::OP_00FF;
 
 
     table8[0x0] = &CHIP8::OP_8xy0;
-    table8[0x1] = &CHIP8::OP_8xy1;
-    table8[0x2] = &CHIP8::OP_8xy2;
-    table8[0x3] = &CHIP8::OP_8xy3;
     table8[0x4] = &CHIP8::OP_8xy4;
     table8[0x5] = &CHIP8::OP_8xy5;
-    table8[0x6] = &CHIP8::OP_8xy6;
     table8[0x7] = &CHIP8::OP_8xy7;
-    table8[0xE] = &CHIP8::OP_8xyE;
 
     tableE[0x1] = &CHIP8::OP_ExA1;
     tableE[0xE] = &CHIP8::OP_Ex9E;
 
     
     // avoid garbage 
-    for (size_t i = 0; i <= 0x65; i++)
+    for (size_t i = 0; i <= 0xFF; i++)
     {
         tableF[i] = &CHIP8::OP_NULL;
     }
 
+    tableF[0x00] = &CHIP8::OP_F000;
+    tableF[0x01] = &CHIP8::OP_Fn01;
+    tableF[0x02] = &CHIP8::OP_F002;
+    tableF[0x3A] = &CHIP8::OP_Fx3A;
     tableF[0x07] = &CHIP8::OP_Fx07;
     tableF[0x0A] = &CHIP8::OP_Fx0A;
     tableF[0x15] = &CHIP8::OP_Fx15;
     tableF[0x18] = &CHIP8::OP_Fx18;
     tableF[0x1E] = &CHIP8::OP_Fx1E;
     tableF[0x29] = &CHIP8::OP_Fx29;
+    tableF[0x30] = &CHIP8::OP_Fx30;
     tableF[0x33] = &CHIP8::OP_Fx33;
-    tableF[0x55] = &CHIP8::OP_Fx55;
-    tableF[0x65] = &CHIP8::OP_Fx65;
+    tableF[0x75] = &CHIP8::OP_Fx75;
+    tableF[0x85] = &CHIP8::OP_Fx85;
+
+    // Same handlers by OpId for the DECODE_LUT dispatch in Cycle
+    handlers[(size_t)OpId::Invalid] = &CHIP8::OP_NULL;
+    handlers[(size_t)OpId::Op00E0] = &CHIP8::OP_00E0;
+    handlers[(size_t)OpId::Op00EE] = &CHIP8::OP_00EE;
+    handlers[(size_t)OpId::Op00Cn] = &CHIP8::OP_00Cn;
+    handlers[(size_t)OpId::Op00FB] = &CHIP8::OP_00FB;
+    handlers[(size_t)OpId::Op00FC] = &CHIP8::OP_00FC;
+    handlers[(size_t)OpId::Op00FD] = &CHIP8::OP_00FD;
+    handlers[(size_t)OpId::Op00FE] = &CHIP8::OP_00FE;
+    handlers[(size_t)OpId::Op00FF] = &CHIP8::OP_00FF;
+    handlers[(size_t)OpId::Op1nnn] = &CHIP8::OP_1nnn;
+    handlers[(size_t)OpId::Op2nnn] = &CHIP8::OP_2nnn;
+    handlers[(size_t)OpId::Op3xkk] = &CHIP8::OP_3xkk;
+    handlers[(size_t)OpId::Op4xkk] = &CHIP8::OP_4xkk;
+    handlers[(size_t)OpId::Op5xy0] = &CHIP8::OP_5xy0;
+    handlers[(size_t)OpId::Op5xy2] = &CHIP8::OP_5xy2;
+    handlers[(size_t)OpId::Op5xy3] = &CHIP8::OP_5xy3;
+    handlers[(size_t)OpId::Op6xkk] = &CHIP8::OP_6xkk;
+    handlers[(size_t)OpId::Op7xkk] = &CHIP8::OP_7xkk;
+    handlers[(size_t)OpId::Op8xy0] = &CHIP8::OP_8xy0;
+    handlers[(size_t)OpId::Op8xy4] = &CHIP8::OP_8xy4;
+    handlers[(size_t)OpId::Op8xy5] = &CHIP8::OP_8xy5;
+    handlers[(size_t)OpId::Op8xy7] = &CHIP8::OP_8xy7;
+    handlers[(size_t)OpId::Op9xy0] = &CHIP8::OP_9xy0;
+    handlers[(size_t)OpId::OpAnnn] = &CHIP8::OP_Annn;
+    handlers[(size_t)OpId::OpCxkk] = &CHIP8::OP_Cxkk;
+    handlers[(size_t)OpId::OpEx9E] = &CHIP8::OP_Ex9E;
+    handlers[(size_t)OpId::OpExA1] = &CHIP8::OP_ExA1;
+    handlers[(size_t)OpId::OpF000] = &CHIP8::OP_F000;
+    handlers[(size_t)OpId::OpFn01] = &CHIP8::OP_Fn01;
+    handlers[(size_t)OpId::OpF002] = &CHIP8::OP_F002;
+    handlers[(size_t)OpId::OpFx3A] = &CHIP8::OP_Fx3A;
+    handlers[(size_t)OpId::OpFx07] = &CHIP8::OP_Fx07;
+    handlers[(size_t)OpId::OpFx0A] = &CHIP8::OP_Fx0A;
+    handlers[(size_t)OpId::OpFx15] = &CHIP8::OP_Fx15;
+    handlers[(size_t)OpId::OpFx18] = &CHIP8::OP_Fx18;
+    handlers[(size_t)OpId::OpFx1E] = &CHIP8::OP_Fx1E;
+    handlers[(size_t)OpId::OpFx29] = &CHIP8::OP_Fx29;
+    handlers[(size_t)OpId::OpFx30] = &CHIP8::OP_Fx30;
+    handlers[(size_t)OpId::OpFx33] = &CHIP8::OP_Fx33;
+    handlers[(size_t)OpId::OpFx75] = &CHIP8::OP_Fx75;
+    handlers[(size_t)OpId::OpFx85] = &CHIP8::OP_Fx85;
+
+    SetQuirks(QuirkProfile::SuperChip);
+}
+
+// The quirk-sensitive opcodes are instantiated per profile; switching
+// profile just repoints their table slots and the engines' entry points
+template <typename Quirks>
+void CHIP8::InstallQuirks()
+{
+    addressMask = Quirks::addressMask;
+    Pc &= addressMask;
+
+    cycleEntry = &CHIP8::CycleFor<Quirks>;
+    fusedEntry = &CHIP8::CycleFusedFor<Quirks>;
+    runEntry[0] = &CHIP8::RunLoop<Quirks, false>;
+    runEntry[1] = &CHIP8::RunLoop<Quirks, true>;
+    fastFrameEntry = &CHIP8::RunFrameFor<FastTiming, Quirks>;
+    vipFrameEntry = &CHIP8::RunFrameFor<VipTiming, Quirks>;
+    dispatchEntry = &CHIP8::DispatchSwitch<Quirks>;
+
+    table[0xB] = &CHIP8::OP_Bnnn<Quirks>;
+    table[0xD] = &CHIP8::OP_Dxyn<Quirks>;
+
+    table8[0x1] = &CHIP8::OP_8xy1<Quirks>;
+    table8[0x2] = &CHIP8::OP_8xy2<Quirks>;
+    table8[0x3] = &CHIP8::OP_8xy3<Quirks>;
+    table8[0x6] = &CHIP8::OP_8xy6<Quirks>;
+    table8[0xE] = &CHIP8::OP_8xyE<Quirks>;
+
+    tableF[0x55] = &CHIP8::OP_Fx55<Quirks>;
+    tableF[0x65] = &CHIP8::OP_Fx65<Quirks>;
+
+    handlers[(size_t)OpId::OpBnnn] = &CHIP8::OP_Bnnn<Quirks>;
+    handlers[(size_t)OpId::OpDxyn] = &CHIP8::OP_Dxyn<Quirks>;
+    handlers[(size_t)OpId::Op8xy1] = &CHIP8::OP_8xy1<Quirks>;
+    handlers[(size_t)OpId::Op8xy2] = &CHIP8::OP_8xy2<Quirks>;
+    handlers[(size_t)OpId::Op8xy3] = &CHIP8::OP_8xy3<Quirks>;
+    handlers[(size_t)OpId::Op8xy6] = &CHIP8::OP_8xy6<Quirks>;
+    handlers[(size_t)OpId::Op8xyE] = &CHIP8::OP_8xyE<Quirks>;
+    handlers[(size_t)OpId::OpFx55] = &CHIP8::OP_Fx55<Quirks>;
+    handlers[(size_t)OpId::OpFx65] = &CHIP8::OP_Fx65<Quirks>;
+}
+
+void CHIP8::SetQuirks(QuirkProfile profile)
+{
+    quirks = profile;
+
+    switch (profile)
+    {
+        case QuirkProfile::CosmacVIP: InstallQuirks<QuirksCosmacVIP>(); break;
+        case QuirkProfile::Chip48:    InstallQuirks<QuirksChip48>(); break;
+        case QuirkProfile::SuperChip: InstallQuirks<QuirksSuperChip>(); break;
+        case QuirkProfile::XOChip:    InstallQuirks<QuirksXOChip>(); break;
+    }
 }
 
 void CHIP8::Table0()
 {
-    ((*this).*(table0[opcode & 0x000Fu]))();
+    ((*this).*(table0[opcode & 0x00FFu]))();
 }
 
 void CHIP8::Table8()
@@ -120,11 +265,23 @@ void CHIP8::TableF()
     ((*this).*(tableF[opcode & 0x00FFu]))();
 }
 
+// Skips step over the whole of a 4-byte F000 nnnn (XO-CHIP)
+void CHIP8::SkipNext()
+{
+    bool longLoad = memory[Pc] == 0xF0 && memory[(Pc + 1) & addressMask] == 0x00;
+    Pc = (Pc + (longLoad ? 4 : 2)) & addressMask;
+}
+
+void CHIP8::Table5()
+{
+    ((*this).*(table5[opcode & 0x000Fu]))();
+}
+
 void CHIP8::OP_NULL()
 	{}
 
 // This function is improved better than the one in the website
-bool CHIP8::loadROM(const char* filename)
+bool CHIP8::loadROM(const char* filename, RomDatabase const* database)
 {
     std::ifstream file(filename, std::ios::binary | std::ios::ate);
 
@@ -135,27 +292,143 @@ bool CHIP8::loadROM(const char* filename)
 
         file.seekg(0, std::ios::beg);
         
+        if (size > (std::streampos)(sizeof(memory) - START_ADDRESS))
+        {
+            return 0;
+        }
+
         std::vector<char> buffer(size);
         if(file.read(buffer.data(), size))
         {
-            for (long i = 0; i < size; i++)
-            {
-                memory[START_ADDRESS + i] = buffer[i];
-            }
-            return 1;
+            const char* extension = std::strrchr(filename, '.');
+            bool xo = extension && std::strcmp(extension, ".xo8") == 0;
+
+            return loadROM(reinterpret_cast<uint8_t const*>(buffer.data()), buffer.size(), database,
+                xo ? QuirkProfile::XOChip : QuirkProfile::SuperChip);
         }
         return 0;
     }
     return 0;
 }
 
+bool CHIP8::loadROM(uint8_t const* data, size_t size, RomDatabase const* database, QuirkProfile fallback)
+{
+    if (size > sizeof(memory) - START_ADDRESS)
+    {
+        return false;
+    }
+
+    uint64_t hash = RomDatabase::Hash(data, size);
+    RomInfo const* info = database ? database->Find(hash) : nullptr;
+    QuirkProfile profile = info ? static_cast<QuirkProfile>(info->profile) : fallback;
+
+    // Fetch wraps at the profile's memory size too, so code past it could
+    // never run
+    if (size > QuirkAddressMask(profile) + 1u - START_ADDRESS)
+    {
+        return false;
+    }
+
+    std::memcpy(&memory[START_ADDRESS], data, size);
+
+    romHash = hash;
+    romInfo = info;
+
+    SetQuirks(profile);
+    return true;
+}
+
 void CHIP8::OP_00E0(){
-    std::fill(std::begin(video), std::end(video), 0);
+    for (unsigned int p = 0; p < PLANES; ++p)
+    {
+        if (planeMask & (1u << p))
+        {
+            std::fill(&video[p][0][0], &video[p][0][0] + HIRES_HEIGHT * 2, 0);
+        }
+    }
+    drawFlag = true;
+}
+
+// Scrolls only move the selected planes (XO-CHIP)
+void CHIP8::OP_00Cn()
+{
+    unsigned int n = opcode & 0x000Fu;
+    unsigned int height = Height();
+
+    for (unsigned int p = 0; p < PLANES; ++p)
+    {
+        if (!(planeMask & (1u << p))) continue;
+
+        for (unsigned int y = height; y-- > n;)
+        {
+            video[p][y][0] = video[p][y - n][0];
+            video[p][y][1] = video[p][y - n][1];
+        }
+        for (unsigned int y = 0; y < n && y < height; ++y)
+        {
+            video[p][y][0] = video[p][y][1] = 0;
+        }
+    }
+    drawFlag = true;
+}
+
+// Horizontal scrolls are whole-word shifts of each packed row; bits pushed
+// past the right edge in lores are masked off
+void CHIP8::OP_00FB()
+{
+    uint64_t rightMask = hires ? ~0ull : 0ull;
+
+    for (unsigned int p = 0; p < PLANES; ++p)
+    {
+        if (!(planeMask & (1u << p))) continue;
+
+        for (unsigned int y = 0; y < Height(); ++y)
+        {
+            video[p][y][1] = ((video[p][y][1] >> 4) | (video[p][y][0] << 60)) & rightMask;
+            video[p][y][0] >>= 4;
+        }
+    }
+    drawFlag = true;
+}
+
+void CHIP8::OP_00FC()
+{
+    for (unsigned int p = 0; p < PLANES; ++p)
+    {
+        if (!(planeMask & (1u << p))) continue;
+
+        for (unsigned int y = 0; y < Height(); ++y)
+        {
+            video[p][y][0] = (video[p][y][0] << 4) | (video[p][y][1] >> 60);
+            video[p][y][1] <<= 4;
+        }
+    }
+    drawFlag = true;
+}
+
+void CHIP8::OP_00FD()
+{
+    // Park on this instruction, like the original interpreter's exit
+    Pc = (Pc - 2) & addressMask;
+}
+
+void CHIP8::OP_00FE()
+{
+    hires = false;
+    OP_00E0();
+}
+
+void CHIP8::OP_00FF()
+{
+    hires = true;
+    OP_00E0();
 }
 
+// sp wraps at 16 like the stack, so a bad ROM corrupts its own stack
+// rather than the emulator
 void CHIP8::OP_00EE(){
-    --sp;
-    Pc = stack[sp];
+    sp = (sp - 1) & 0xFu;
+    Pc = stack[sp] & addressMask;
 
 }
 
@@ -170,7 +443,7 @@ void CHIP8::OP_2nnn() // empty stack convention
     uint16_t address = opcode & 0x0FFFu;
 
     stack[sp] = Pc;
-    ++sp;
+    sp = (sp + 1) & 0xFu;
     Pc = address;
 }
 
@@ -181,7 +454,7 @@ void CHIP8::OP_3xkk()
 
     if(V[Vx] == byte)
     {
-        Pc += 2;
+        SkipNext();
     }
 }
 
@@ -192,7 +465,7 @@ void CHIP8::OP_4xkk()
 
     if(V[Vx] != byte)
     {
-        Pc += 2;
+        SkipNext();
     }
 }
 
@@ -201,7 +474,33 @@ void CHIP8::OP_5xy0()
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
     uint8_t Vy = (opcode & 0x00F0u) >> 4u ;
     if(V[Vx] == V[Vy]){
-        Pc += 2;
+        SkipNext();
+    }
+}
+
+void CHIP8::OP_5xy2()
+{
+    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    int step = Vx <= Vy ? 1 : -1;
+
+    for (int i = 0, r = Vx; ; ++i, r += step)
+    {
+        memory[(index + i) & addressMask] = V[r];
+        if (r == Vy) break;
+    }
+}
+
+void CHIP8::OP_5xy3()
+{
+    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    int step = Vx <= Vy ? 1 : -1;
+
+    for (int i = 0, r = Vx; ; ++i, r += step)
+    {
+        V[r] = memory[(index + i) & addressMask];
+        if (r == Vy) break;
     }
 }
 
@@ -229,28 +528,46 @@ void CHIP8::OP_8xy0()
     V[Vx] = V[Vy];
 }
 
+template <typename Quirks>
 void CHIP8::OP_8xy1()
 {
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
     uint8_t Vy = (opcode & 0x00F0u) >> 4u;
 
     V[Vx] |= V[Vy]; // Vx = Vx OR Vy
+
+    if constexpr (Quirks::logicResetsVF)
+    {
+        V[0xF] = 0;
+    }
 }
 
+template <typename Quirks>
 void CHIP8::OP_8xy2()
 {
      uint8_t Vx = (opcode & 0x0F00u) >> 8u;
     uint8_t Vy = (opcode & 0x00F0u) >> 4u;
 
     V[Vx] &= V[Vy]; // Vx = Vx AND Vy
+
+    if constexpr (Quirks::logicResetsVF)
+    {
+        V[0xF] = 0;
+    }
 }
 
+template <typename Quirks>
 void CHIP8::OP_8xy3()
 {
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
     uint8_t Vy = (opcode & 0x00F0u) >> 4u;
 
     V[Vx] ^= V[Vy]; // Vx = Vx XOR Vy
+
+    if constexpr (Quirks::logicResetsVF)
+    {
+        V[0xF] = 0;
+    }
 }
 
 void CHIP8::OP_8xy4()
@@ -286,10 +603,16 @@ void CHIP8::OP_8xy5()
     V[Vx] -= V[Vy];
 }
 
+template <typename Quirks>
 void CHIP8::OP_8xy6()
 {
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 
+    if constexpr (Quirks::shiftUsesVy)
+    {
+        V[Vx] = V[(opcode & 0x00F0u) >> 4u];
+    }
+
     V[0xF] = (V[Vx] & 0x1u);
 
     V[Vx] >>= 1;
@@ -311,10 +634,16 @@ void CHIP8::OP_8xy7()
     V[Vx] = (V[Vy] - V[Vx]);
 }
 
+template <typename Quirks>
 void CHIP8::OP_8xyE()
 {
      uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 
+    if constexpr (Quirks::shiftUsesVy)
+    {
+        V[Vx] = V[(opcode & 0x00F0u) >> 4u];
+    }
+
     V[0xF] = (V[Vx] & 0x80u) >> 7u;
 
     V[Vx] <<= 1;
@@ -327,7 +656,7 @@ void CHIP8::OP_9xy0()
     uint8_t Vy = (opcode & 0x00F0u) >> 4u;
 
     if(V[Vx] != V[Vy]){
-        Pc += 2;
+        SkipNext();
     }
 }
 
@@ -338,11 +667,19 @@ void CHIP8::OP_Annn()
     index = address;
 }
 
+template <typename Quirks>
 void CHIP8::OP_Bnnn()
 {
     uint16_t address = (opcode & 0x0FFFu);
 
-    Pc = V[0] + address;
+    if constexpr (Quirks::jumpUsesVx)
+    {
+        Pc = (V[(opcode & 0x0F00u) >> 8u] + address) & Quirks::addressMask; // Bxnn
+    }
+    else
+    {
+        Pc = (V[0] + address) & Quirks::addressMask;
+    }
 }
 
 void CHIP8::OP_Cxkk()
@@ -350,52 +687,107 @@ void CHIP8::OP_Cxkk()
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
     uint8_t byte = opcode & 0x00FFu;
 
-    V[Vx] = randByte(randGen) & byte;
+    // The engine's output is 31 bits; its low bits are the weakest
+    V[Vx] = (uint8_t)(randGen() >> 16u) & byte;
 }
 
+template <typename Quirks>
 void CHIP8::OP_Dxyn()
 {
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
     uint8_t Vy = (opcode & 0x00F0u) >> 4u;
     uint8_t height = (opcode & 0x000Fu);
+    unsigned int width = 8;
+
+    // Dxy0 draws a 16x16 sprite, two bytes per row
+    if (height == 0)
+    {
+        height = 16;
+        width = 16;
+    }
 
     // Initial starting positions (wrapped if they start off-screen)
-    uint8_t xPos = V[Vx] % VIDEO_WIDTH;
-    uint8_t yPos = V[Vy] % VIDEO_HEIGHT;
+    unsigned int xPos = V[Vx] & (Width() - 1);
+    unsigned int yPos = V[Vy] & (Height() - 1);
+
+    // Sprite pixels past the right edge are clipped by this mask (or, when
+    // wrapping, folded back onto the left edge first)
+    uint64_t rightMask = hires ? ~0ull : 0ull;
 
     V[0xF] = 0; // Reset collision register
+    drawFlag = true;
 
-    for (unsigned int row = 0; row < height; ++row)
-    {
-        // Safety: If the next row is off the bottom of the screen, stop drawing
-        if (yPos + row >= VIDEO_HEIGHT) break;
+    // Each selected plane takes the next sprite's worth of bytes from I
+    uint16_t address = index;
 
-        uint8_t spriteByte = memory[index + row];
+    for (unsigned int p = 0; p < PLANES; ++p)
+    {
+        if (!(planeMask & (1u << p))) continue;
 
-        for (unsigned int col = 0; col < 8; ++col)
+        for (unsigned int row = 0; row < height; ++row)
         {
-            // Safety: If the next pixel is off the right side, skip this pixel
-            if (xPos + col >= VIDEO_WIDTH) break;
+            unsigned int y = yPos + row;
 
-            uint8_t spritePixel = spriteByte & (0x80u >> col);
-            
-            // Pointer to the specific pixel in our 1D video array
-            uint32_t* screenPixel = &video[(yPos + row) * VIDEO_WIDTH + (xPos + col)];
+            if constexpr (Quirks::clipSprites)
+            {
+                // Safety: If the next row is off the bottom of the screen, stop drawing
+                if (y >= Height()) break;
+            }
+            else
+            {
+                y &= Height() - 1;
+            }
+
+            uint64_t spriteRow;
+            if (width == 16)
+            {
+                spriteRow = (uint64_t)((memory[(address + row * 2) & Quirks::addressMask] << 8u)
+                    | memory[(address + row * 2 + 1) & Quirks::addressMask]) << 48u;
+            }
+            else
+            {
+                spriteRow = (uint64_t)memory[(address + row) & Quirks::addressMask] << 56u;
+            }
+
+            // Shift the left-aligned sprite row to xPos across the two words
+            uint64_t left, right;
+            if (xPos < 64)
+            {
+                left = spriteRow >> xPos;
+                right = xPos ? spriteRow << (64 - xPos) : 0;
+            }
+            else
+            {
+                left = 0;
+                right = spriteRow >> (xPos - 64);
+            }
 
-            if (spritePixel)
+            if constexpr (!Quirks::clipSprites)
             {
-                // Collision Detection: 
-                // If the screen pixel is already ON (White), set VF to 1
-                if (*screenPixel == 0xFFFFFFFF)
+                if (hires)
                 {
-                    V[0xF] = 1;
+                    left |= xPos > 64 ? spriteRow << (128 - xPos) : 0;
                 }
+                else
+                {
+                    left |= right;
+                }
+            }
+            right &= rightMask;
 
-                // XOR the pixel: 
-                // This turns White to Black and Black to White
-                *screenPixel ^= 0xFFFFFFFF;
+            uint64_t* screenRow = video[p][y];
+
+            // Collision Detection: any lit pixel turned off sets VF
+            if ((screenRow[0] & left) | (screenRow[1] & right))
+            {
+                V[0xF] = 1;
             }
+
+            // XOR the sprite in, a whole row at a time
+            screenRow[0] ^= left;
+            screenRow[1] ^= right;
         }
+        address += height * (width / 8);
     }
 }
 
@@ -404,10 +796,11 @@ void CHIP8::OP_Ex9E()
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 
     uint8_t key = V[Vx];
+    keyReads |= 1u << (key & 0xFu);
 
-    if (keypad[key])
+    if (keypad[key & 0xFu])
     {
-    Pc += 2;
+    SkipNext();
     }
 }
 
@@ -416,13 +809,45 @@ void CHIP8::OP_ExA1()
         uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 
     uint8_t key = V[Vx];
+    keyReads |= 1u << (key & 0xFu);
 
-    if (!keypad[key])
+    if (!keypad[key & 0xFu])
     {
-        Pc += 2;
+        SkipNext();
     }
 }
 
+void CHIP8::OP_F000()
+{
+    // tableF is indexed by the low byte only; F100-FF00 are not instructions
+    if (opcode != 0xF000u)
+    {
+        return;
+    }
+
+    index = (memory[Pc] << 8u) | memory[(Pc + 1) & addressMask];
+    Pc = (Pc + 2) & addressMask;
+}
+
+void CHIP8::OP_Fn01()
+{
+    planeMask = ((opcode & 0x0F00u) >> 8u) & 0x3u;
+}
+
+void CHIP8::OP_F002()
+{
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        pattern[i] = memory[(index + i) & addressMask];
+    }
+}
+
+void CHIP8::OP_Fx3A()
+{
+    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    pitch = V[Vx];
+}
+
 void CHIP8::OP_Fx07()
 {
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
@@ -433,6 +858,7 @@ void CHIP8::OP_Fx0A()
 {
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
     bool keyPressed = false;
+    keyReads = 0xFFFFu;
 
     for(int i = 0; i < 16; ++i)
     {
@@ -446,7 +872,7 @@ void CHIP8::OP_Fx0A()
    
     if(!keyPressed)
     {
-        Pc -= 2;
+        Pc = (Pc - 2) & addressMask;
     }
 
 }
@@ -477,61 +903,450 @@ void CHIP8::OP_Fx29()
     index = FONTSET_START_ADDRESS + (digit *5);
 }
 
+void CHIP8::OP_Fx30()
+{
+    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t digit = V[Vx] & 0xFu;
+
+    index = BIGFONT_START_ADDRESS + (digit * 10);
+}
+
 void CHIP8::OP_Fx33()
 {
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
     uint8_t value = V[Vx];
 
-    memory[index + 2] = value % 10;
+    memory[(index + 2) & addressMask] = value % 10;
     value /= 10;
 
-    memory[index+1] = value % 10;
+    memory[(index + 1) & addressMask] = value % 10;
     value /= 10;
 
-    memory[index] = value%10;
+    memory[index & addressMask] = value%10;
 }
 
+template <typename Quirks>
 void CHIP8::OP_Fx55()
 {
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 
     for(uint8_t i = 0; i <= Vx; ++i)
     {
-        memory[index + i] = V[i];
+        memory[(index + i) & Quirks::addressMask] = V[i];
+    }
+
+    if constexpr (Quirks::loadStoreIndex == IndexQuirk::AddX)
+    {
+        index += Vx;
+    }
+    else if constexpr (Quirks::loadStoreIndex == IndexQuirk::AddXPlus1)
+    {
+        index += Vx + 1;
     }
 }
 
+template <typename Quirks>
 void CHIP8::OP_Fx65()
 {
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 
     for (uint8_t i = 0; i <= Vx; ++i)
     {
-        V[i] = memory[index + i];
+        V[i] = memory[(index + i) & Quirks::addressMask];
+    }
+
+    if constexpr (Quirks::loadStoreIndex == IndexQuirk::AddX)
+    {
+        index += Vx;
+    }
+    else if constexpr (Quirks::loadStoreIndex == IndexQuirk::AddXPlus1)
+    {
+        index += Vx + 1;
+    }
+}
+
+void CHIP8::OP_Fx75()
+{
+    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+
+    for (uint8_t i = 0; i <= Vx; ++i)
+    {
+        flags[i] = V[i];
     }
 }
 
+void CHIP8::OP_Fx85()
+{
+    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 
+    for (uint8_t i = 0; i <= Vx; ++i)
+    {
+        V[i] = flags[i];
+    }
+}
+
+// The public engines go through the entry points SetQuirks picked, so the
+// profile is decided once per call rather than per instruction
 void CHIP8::Cycle()
 {
-    opcode = (memory[Pc] << 8u) | memory[Pc+1];
+    (this->*cycleEntry)();
+}
+
+unsigned int CHIP8::CycleFused(unsigned int limit)
+{
+    return (this->*fusedEntry)(limit);
+}
+
+// Breakpoints get their own instantiation, so the loop the frontends run
+// every frame has no per-instruction breakpoint test
+CHIP8::RunResult CHIP8::Run(unsigned int maxCycles, uint32_t stopMask, std::bitset<65536> const* breakpoints)
+{
+    bool checkBreakpoints = breakpoints && (stopMask & STOP_BREAKPOINT);
+    return (this->*runEntry[checkBreakpoints])(maxCycles, stopMask, breakpoints);
+}
+
+template <typename Timing>
+unsigned int CHIP8::RunFrame(unsigned int budget)
+{
+    if constexpr (std::is_same_v<Timing, FastTiming>)
+    {
+        return (this->*fastFrameEntry)(budget);
+    }
+    else
+    {
+        return (this->*vipFrameEntry)(budget);
+    }
+}
 
-    Pc += 2;
+template unsigned int CHIP8::RunFrame<FastTiming>(unsigned int);
+template unsigned int CHIP8::RunFrame<VipTiming>(unsigned int);
+
+// Fetch wraps at the profile's memory size like every other access, so
+// Pc never leaves it; in the per-profile loops the mask is a constant
+template <typename Quirks>
+void CHIP8::CycleFor()
+{
+    opcode = (memory[Pc] << 8u) | memory[(Pc + 1) & Quirks::addressMask];
+
+    Pc = (Pc + 2) & Quirks::addressMask;
+
+    DispatchSwitch<Quirks>(DECODE_LUT.ids[opcode]);
+}
+
+void CHIP8::CycleHandlers()
+{
+    opcode = (memory[Pc] << 8u) | memory[(Pc + 1) & addressMask];
+
+    Pc = (Pc + 2) & addressMask;
+
+    ((*this).*(handlers[(size_t)DECODE_LUT.ids[opcode]]))();
+}
+
+void CHIP8::CycleTables()
+{
+    opcode = (memory[Pc] << 8u) | memory[(Pc + 1) & addressMask];
+
+    Pc = (Pc + 2) & addressMask;
 
     ((*this).*(table[(opcode & 0xF000u) >> 12u]))  ();
+}
 
-    if(delayTimer)
+// Superinstructions are recognised at fetch from the words in memory, not
+// cached per address, so ROMs that write over their own code (Fx33/Fx55
+// into the next instruction's operands) stay correct. None of the fused
+// sequences writes memory before its last instruction.
+template <typename Quirks>
+unsigned int CHIP8::CycleFusedFor(unsigned int limit)
+{
+    constexpr uint16_t mask = Quirks::addressMask;
+    uint16_t first = (memory[Pc] << 8u) | memory[(Pc + 1) & mask];
+    uint16_t second = (memory[(Pc + 2) & mask] << 8u) | memory[(Pc + 3) & mask];
+
+    switch (DECODE_LUT.ids[first])
     {
-        --delayTimer;
+        case OpId::Op1nnn:
+            // Nothing changes until the frame ends
+            if ((first & 0x0FFFu) == Pc)
+            {
+                opcode = first;
+                return limit;
+            }
+            break;
+
+        case OpId::OpFx07:
+        {
+            uint8_t Vx = (first & 0x0F00u) >> 8u;
+            uint16_t third = (memory[(Pc + 4) & mask] << 8u) | memory[(Pc + 5) & mask];
+
+            // 1nnn only reaches the first 4 KB, so above it no jump is to Pc
+            if (second != (0x3000u | (Vx << 8u)) || Pc > 0x0FFFu || third != (0x1000u | Pc))
+            {
+                break;
+            }
+
+            if (delayTimer == 0 && limit >= 2)
+            {
+                // Skips the jump and leaves the loop
+                V[Vx] = 0;
+                opcode = second;
+                Pc = (Pc + 6) & mask;
+                return 2;
+            }
+            if (delayTimer != 0 && limit >= 3)
+            {
+                // Every pass ends where it began with the same state, so
+                // run all the whole passes that fit at once
+                V[Vx] = delayTimer;
+                opcode = third;
+                return limit - limit % 3;
+            }
+            break;
+        }
+
+        case OpId::OpAnnn:
+            if (limit >= 2 && DECODE_LUT.ids[second] == OpId::OpDxyn)
+            {
+                opcode = first;
+                OP_Annn();
+                opcode = second;
+                Pc = (Pc + 4) & mask;
+                DispatchSwitch<Quirks>(OpId::OpDxyn);
+                return 2;
+            }
+            break;
+
+        case OpId::Op6xkk:
+            if (limit >= 2 && (second & 0xF000u) == 0x6000u)
+            {
+                opcode = first;
+                OP_6xkk();
+                opcode = second;
+                OP_6xkk();
+                Pc = (Pc + 4) & mask;
+                return 2;
+            }
+            break;
+
+        default:
+            break;
     }
 
-    if(soundTimer)
+    opcode = first;
+    Pc = (Pc + 2) & mask;
+    DispatchSwitch<Quirks>(DECODE_LUT.ids[first]);
+    return 1;
+}
+
+// Run's stop events for each instruction, before checking they happened
+static constexpr uint32_t Events(OpId id)
+{
+    switch (id)
     {
-        --soundTimer;
+        case OpId::Op00E0: case OpId::Op00Cn: case OpId::Op00FB: case OpId::Op00FC:
+        case OpId::Op00FE: case OpId::Op00FF: case OpId::OpDxyn:
+            return CHIP8::STOP_DRAW;
+        case OpId::OpFx0A: return CHIP8::STOP_KEY_WAIT;
+        case OpId::OpFx18: return CHIP8::STOP_SOUND;
+        default: return 0;
     }
+}
+
+template <typename Quirks, bool Breakpoints>
+CHIP8::RunResult CHIP8::RunLoop(unsigned int maxCycles, uint32_t stopMask, std::bitset<65536> const* breakpoints)
+{
+    for (runCycles = 0; runCycles < maxCycles; )
+    {
+        if constexpr (Breakpoints)
+        {
+            if (runCycles > 0 && (*breakpoints)[Pc])
+            {
+                return RunResult::Breakpoint;
+            }
+        }
+
+        uint16_t pc = Pc;
+        uint8_t sound = soundTimer;
+
+        opcode = (memory[Pc] << 8u) | memory[(Pc + 1) & Quirks::addressMask];
+        OpId id = DECODE_LUT.ids[opcode];
 
+        Pc = (Pc + 2) & Quirks::addressMask;
+        DispatchSwitch<Quirks>(id);
+        ++runCycles;
 
+        if (uint32_t events = Events(id) & stopMask)
+        {
+            if (events & STOP_DRAW)
+            {
+                return RunResult::Draw;
+            }
+            if ((events & STOP_KEY_WAIT) && Pc == pc)
+            {
+                return RunResult::KeyWait;
+            }
+            if ((events & STOP_SOUND) && sound == 0 && soundTimer != 0)
+            {
+                return RunResult::SoundStart;
+            }
+        }
+    }
+    return RunResult::FrameEnd;
+}
 
+template <typename Timing, typename Quirks>
+unsigned int CHIP8::RunFrameFor(unsigned int budget)
+{
+    unsigned int executed = 0;
+    int remaining = (int)budget + timingCarry;
 
+    while (remaining > 0)
+    {
+        if constexpr (Timing::fuses)
+        {
+            unsigned int count = CycleFusedFor<Quirks>((unsigned int)remaining);
+            executed += count;
+            remaining -= (int)count;
+        }
+        else
+        {
+            unsigned int cost = Timing::Cost(*this, (memory[Pc] << 8u) | memory[(Pc + 1) & Quirks::addressMask]);
+
+            CycleFor<Quirks>();
+            ++executed;
 
-}
\ No newline at end of file
+            if constexpr (Timing::waitsForDisplay)
+            {
+                // Resumes right after the display interrupt, nothing carried over
+                if (cost == Timing::DISPLAY_WAIT)
+                {
+                    remaining = 0;
+                    break;
+                }
+            }
+            remaining -= (int)cost;
+        }
+    }
+
+    timingCarry = remaining;
+    UpdateTimers();
+
+    return executed;
+}
+
+void CHIP8::CycleSwitch()
+{
+    opcode = (memory[Pc] << 8u) | memory[(Pc + 1) & addressMask];
+
+    Pc = (Pc + 2) & addressMask;
+
+    (this->*dispatchEntry)(Decode(opcode));
+}
+
+template <typename Quirks>
+void CHIP8::DispatchSwitch(OpId id)
+{
+    switch (id)
+    {
+        case OpId::Op00E0: OP_00E0(); break;
+        case OpId::Op00EE: OP_00EE(); break;
+        case OpId::Op00Cn: OP_00Cn(); break;
+        case OpId::Op00FB: OP_00FB(); break;
+        case OpId::Op00FC: OP_00FC(); break;
+        case OpId::Op00FD: OP_00FD(); break;
+        case OpId::Op00FE: OP_00FE(); break;
+        case OpId::Op00FF: OP_00FF(); break;
+        case OpId::Op1nnn: OP_1nnn(); break;
+        case OpId::Op2nnn: OP_2nnn(); break;
+        case OpId::Op3xkk: OP_3xkk(); break;
+        case OpId::Op4xkk: OP_4xkk(); break;
+        case OpId::Op5xy0: OP_5xy0(); break;
+        case OpId::Op5xy2: OP_5xy2(); break;
+        case OpId::Op5xy3: OP_5xy3(); break;
+        case OpId::Op6xkk: OP_6xkk(); break;
+        case OpId::Op7xkk: OP_7xkk(); break;
+        case OpId::Op8xy0: OP_8xy0(); break;
+        case OpId::Op8xy1: OP_8xy1<Quirks>(); break;
+        case OpId::Op8xy2: OP_8xy2<Quirks>(); break;
+        case OpId::Op8xy3: OP_8xy3<Quirks>(); break;
+        case OpId::Op8xy4: OP_8xy4(); break;
+        case OpId::Op8xy5: OP_8xy5(); break;
+        case OpId::Op8xy6: OP_8xy6<Quirks>(); break;
+        case OpId::Op8xy7: OP_8xy7(); break;
+        case OpId::Op8xyE: OP_8xyE<Quirks>(); break;
+        case OpId::Op9xy0: OP_9xy0(); break;
+        case OpId::OpAnnn: OP_Annn(); break;
+        case OpId::OpBnnn: OP_Bnnn<Quirks>(); break;
+        case OpId::OpCxkk: OP_Cxkk(); break;
+        case OpId::OpDxyn: OP_Dxyn<Quirks>(); break;
+        case OpId::OpEx9E: OP_Ex9E(); break;
+        case OpId::OpExA1: OP_ExA1(); break;
+        case OpId::OpF000: OP_F000(); break;
+        case OpId::OpFn01: OP_Fn01(); break;
+        case OpId::OpF002: OP_F002(); break;
+        case OpId::OpFx3A: OP_Fx3A(); break;
+        case OpId::OpFx07: OP_Fx07(); break;
+        case OpId::OpFx0A: OP_Fx0A(); break;
+        case OpId::OpFx15: OP_Fx15(); break;
+        case OpId::OpFx18: OP_Fx18(); break;
+        case OpId::OpFx1E: OP_Fx1E(); break;
+        case OpId::OpFx29: OP_Fx29(); break;
+        case OpId::OpFx30: OP_Fx30(); break;
+        case OpId::OpFx33: OP_Fx33(); break;
+        case OpId::OpFx55: OP_Fx55<Quirks>(); break;
+        case OpId::OpFx65: OP_Fx65<Quirks>(); break;
+        case OpId::OpFx75: OP_Fx75(); break;
+        case OpId::OpFx85: OP_Fx85(); break;
+        default: OP_NULL(); break;
+    }
+}
+
+uint64_t CHIP8::StateHash() const
+{
+    uint8_t registers[] = {
+        (uint8_t)index, (uint8_t)(index >> 8), (uint8_t)Pc, (uint8_t)(Pc >> 8),
+        sp, delayTimer, soundTimer, pitch, hires, planeMask
+    };
+
+    uint64_t hash = RomDatabase::Hash(registers, sizeof(registers));
+    hash = RomDatabase::Hash(V, sizeof(V), hash);
+    hash = RomDatabase::Hash(reinterpret_cast<uint8_t const*>(stack), sizeof(stack), hash);
+    hash = RomDatabase::Hash(pattern, sizeof(pattern), hash);
+    hash = RomDatabase::Hash(flags, sizeof(flags), hash);
+    hash = RomDatabase::Hash(keypad, sizeof(keypad), hash);
+    hash = RomDatabase::Hash(reinterpret_cast<uint8_t const*>(video), sizeof(video), hash);
+    return RomDatabase::Hash(memory, sizeof(memory), hash);
+}
+
+uint64_t CHIP8::FramebufferHash(uint64_t hash) const
+{
+    constexpr uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ull;
+
+    hash = (hash ^ hires) * MULTIPLIER;
+    for (auto const& plane : video)
+    {
+        for (auto const& row : plane)
+        {
+            for (uint64_t word : row)
+            {
+                // The shift folds the high bits back down so a pixel's
+                // change reaches every bit of the words after it
+                hash = (hash ^ word) * MULTIPLIER;
+                hash ^= hash >> 32;
+            }
+        }
+    }
+    return hash;
+}
+
+void CHIP8::UpdateTimers()
+{
+    if(delayTimer)
+    {
+        --delayTimer;
+    }
+
+    if(soundTimer)
+    {
+        --soundTimer;
+    }
+}
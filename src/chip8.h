@@ -1,9 +1,15 @@
 // chip8.h
+#pragma once
 
+#include <bitset>
 #include <cstdint>
 #include <chrono>
 #include <random>
 
+#include "decode.h"
+#include "quirks.h"
+#include "romdb.h"
+
 class CHIP8
 {
     public:
@@ -11,43 +17,167 @@ class CHIP8
     static constexpr unsigned int START_ADDRESS = 0x200;
     static constexpr unsigned int FONTSET_SIZE = 80;
     static constexpr unsigned int FONTSET_START_ADDRESS = 0x50;
+    static constexpr unsigned int BIGFONT_SIZE = 160;
+    static constexpr unsigned int BIGFONT_START_ADDRESS = 0xA0;
     static constexpr unsigned int VIDEO_WIDTH = 64;
     static constexpr unsigned int VIDEO_HEIGHT =  32;
+    static constexpr unsigned int HIRES_WIDTH = 128;   // SUPER-CHIP
+    static constexpr unsigned int HIRES_HEIGHT = 64;
+    static constexpr unsigned int PLANES = 2;          // XO-CHIP bitplanes
 
-    std::default_random_engine randGen;
-    std::uniform_int_distribution<uint8_t> randByte;
+    // A named engine rather than default_random_engine, so Cxkk sequences
+    // and the saved generator state are the same with every standard library
+    std::minstd_rand randGen;
     
 
     uint16_t opcode;
-    uint8_t memory[4096]{};
+    uint8_t memory[65536]{}; // XO-CHIP address space, CHIP-8 uses the first 4 KB
+    uint16_t addressMask{0xFFFF}; // memory size - 1 for the quirk profile
     uint8_t V[16]{}; // Registers
     uint16_t index{},Pc{};
     uint16_t stack[16]{};
     uint8_t sp{};
     uint8_t delayTimer{}, soundTimer{};
+    uint8_t pattern[16]{}; // XO-CHIP 1-bit audio pattern, played MSB first
+    uint8_t pitch{64};     // XO-CHIP playback rate 4000*2^((pitch-64)/48) Hz
     uint8_t keypad[16]{};
-    uint32_t video[64 * 32]{};
+    uint16_t keyReads{}; // bit n set once key n is tested by Ex9E/ExA1/Fx0A
+    uint8_t flags[16]{}; // SUPER-CHIP RPL user flags (Fx75/Fx85)
+
+    // Packed framebuffer per bitplane, one bit per pixel, 128 bits per row
+    // in two words, x = 0 is the MSB of word 0. Lores mode uses the top-left
+    // 64x32. A pixel's colour index is (plane 1 bit << 1) | plane 0 bit.
+    uint64_t video[PLANES][HIRES_HEIGHT][2]{};
+    bool hires{};
+    uint8_t planeMask{1}; // planes affected by draw/clear/scroll (Fn01)
+    bool drawFlag{}; // set by 00E0/Dxyn, cleared by the host once presented
 
     uint8_t fontset[FONTSET_SIZE];
+    uint8_t bigFontset[BIGFONT_SIZE];
 
     
     typedef void (CHIP8::*Chip8func)();
 
 
     Chip8func table[0xF + 1]{};
-    Chip8func table0[0xE + 1]{};
-    Chip8func table8[0xE + 1]{};
-    Chip8func tableE[0xE + 1]{};
-    Chip8func tableF[0x65 +1]{};
+    Chip8func table0[0xFF + 1]{};
+    Chip8func table5[0xF + 1]{};
+    // Sized for every index the opcode can produce, unused slots are OP_NULL
+    Chip8func table8[0xF + 1]{};
+    Chip8func tableE[0xF + 1]{};
+    Chip8func tableF[0xFF + 1]{};
+
+    // One handler per OpId; CycleHandlers reaches them through DECODE_LUT
+    Chip8func handlers[(size_t)OpId::Count]{};
 
 
 
     CHIP8();
 
+    // Fetch, one DECODE_LUT load for the handler id, then a switch over
+    // ids per profile that the handlers inline into. The profile's
+    // instantiation is chosen by SetQuirks, as for every engine below.
     void Cycle();
 
-
-    bool loadROM(const char* filename);
+    // Like Cycle, but runs a superinstruction when Pc is at one of the
+    // sequences below, as long as it fits in limit (>= 1) instructions.
+    // Returns the number of instructions executed.
+    //   Fx07 3x00 1nnn  timer wait looping on itself, repeated to the limit
+    //   1nnn            jump to itself, repeated to the limit
+    //   Annn Dxyn       point I at a sprite and draw it
+    //   6xkk 6xkk       load two registers
+    unsigned int CycleFused(unsigned int limit);
+
+    // The nested table dispatch Cycle used before DECODE_LUT, and
+    // DECODE_LUT to the handlers[] member pointers after it; kept as
+    // engines to compare against
+    void CycleTables();
+    void CycleHandlers();
+
+    // Reference engine: the same handlers reached through a switch on
+    // Decode() instead of the tables, for the conformance harness
+    void CycleSwitch();
+
+    // Events Run can stop on, or'ed into its stopMask
+    static constexpr uint32_t STOP_DRAW = 1u << 0;        // 00E0, Dxyn, scroll or resolution change
+    static constexpr uint32_t STOP_KEY_WAIT = 1u << 1;    // Fx0A found no key down
+    static constexpr uint32_t STOP_BREAKPOINT = 1u << 2;  // Pc reached an address in Run's breakpoints
+    static constexpr uint32_t STOP_SOUND = 1u << 3;       // Fx18 started the silent sound timer
+
+    enum class RunResult
+    {
+        FrameEnd,       // maxCycles ran, the caller's frame budget
+        Draw,
+        KeyWait,        // Pc is left on the Fx0A
+        Breakpoint,     // stopped before the instruction at Pc
+        SoundStart
+    };
+
+    // Runs up to maxCycles instructions in one loop, stopping after the
+    // first one that raises an event in stopMask (before it, for
+    // breakpoints). Timers are the caller's, as with Cycle. Breakpoints are
+    // the caller's too, one bit per address, only read with
+    // STOP_BREAKPOINT. A breakpoint under Pc on entry is stepped over, so
+    // calling Run again resumes. runCycles holds the instructions the last
+    // Run executed.
+    RunResult Run(unsigned int maxCycles, uint32_t stopMask,
+        std::bitset<65536> const* breakpoints = nullptr);
+    unsigned int runCycles{};
+
+    // Hash of everything that affects execution or output, for comparing
+    // engines and runs
+    uint64_t StateHash() const;
+
+    // Hash of the screen, both planes and the resolution. A multiply per
+    // framebuffer word rather than StateHash's per byte, cheap enough to
+    // take every frame; pass the previous result to chain frames.
+    uint64_t FramebufferHash(uint64_t hash = 0xCBF29CE484222325ull) const;
+
+    // Save states: a little-endian image of the machine, the quirk profile,
+    // the timing carry and the random generator, StateSize() bytes. The
+    // database entry is kept only if the ROM hash matches. Both fail on a
+    // short buffer; LoadState also on another version's state or one the
+    // core can't run from (stack pointer, plane mask, Pc, random generator
+    // out of range), leaving the machine as it was.
+    static constexpr uint32_t STATE_VERSION = 2;
+    static size_t StateSize();
+    bool SaveState(uint8_t* out, size_t size) const;
+    bool LoadState(uint8_t const* data, size_t size);
+
+    // Current display mode size
+    unsigned int Width() const { return hires ? HIRES_WIDTH : VIDEO_WIDTH; }
+    unsigned int Height() const { return hires ? HIRES_HEIGHT : VIDEO_HEIGHT; }
+
+    // Decrement delay/sound timers, call at 60 Hz
+    void UpdateTimers();
+
+    // Runs one 60 Hz frame: instructions until the Timing model's budget is
+    // spent, then the timers. Each model is its own instantiation, so the
+    // FastTiming loop carries no cost accounting, and runs superinstructions
+    // through CycleFused. Returns instructions run.
+    template <typename Timing>
+    unsigned int RunFrame(unsigned int budget);
+
+    // Machine cycles a timed frame overran its budget by, charged to the next
+    int timingCarry{};
+
+
+    // Loads the ROM and looks its hash up in the database, if given. Known
+    // ROMs get their recorded quirk profile, others one from the extension
+    // (.xo8 XO-CHIP, anything else SUPER-CHIP). Fails if the ROM doesn't
+    // fit the profile's memory (3.5 KB for the 4 KB profiles).
+    bool loadROM(const char* filename, RomDatabase const* database = nullptr);
+
+    // Same from an image in memory; unknown ROMs get the fallback profile
+    bool loadROM(uint8_t const* data, size_t size, RomDatabase const* database = nullptr,
+        QuirkProfile fallback = QuirkProfile::SuperChip);
+    uint64_t romHash{};
+    RomInfo const* romInfo{}; // database entry, valid while the database is open
+
+    // Installs the profile's specialised opcode handlers in the tables and
+    // points the engines at their instantiations for it
+    void SetQuirks(QuirkProfile profile);
+    QuirkProfile quirks{};
 
     // OPCODES
 
@@ -57,6 +187,14 @@ class CHIP8
     //RET - return from a subroutine
     void OP_00EE();
     
+    // SUPER-CHIP display control
+    void OP_00Cn(); // Scroll down n rows
+    void OP_00FB(); // Scroll right 4 pixels
+    void OP_00FC(); // Scroll left 4 pixels
+    void OP_00FD(); // Exit interpreter
+    void OP_00FE(); // Low resolution (64x32)
+    void OP_00FF(); // High resolution (128x64)
+
     //JP addr - Jump to location nnn
     void OP_1nnn();
     
@@ -72,6 +210,10 @@ class CHIP8
     //5xk0 - SE Vx, Vy - Skip next instruction if Vx = Vy
     void OP_5xy0();
 
+    // XO-CHIP: save/load Vx..Vy to/from memory[I], I unchanged
+    void OP_5xy2();
+    void OP_5xy3();
+
     //6xkk - LD Vx, byte - Set Vx = kk
     void OP_6xkk();
 
@@ -82,13 +224,13 @@ class CHIP8
     void OP_8xy0();
 
     //8xy1 - OR Vx, Vy - Set Vx = Vx OR Vy
-    void OP_8xy1();
+    template <typename Quirks> void OP_8xy1();
 
     //8xy2 - AND Vx, Vy - Set Vx = Vx AND Vy
-    void OP_8xy2();
+    template <typename Quirks> void OP_8xy2();
 
     //8xy3 - XOR Vx, Vy - Set Vx = Vx XOR Vy
-    void OP_8xy3();
+    template <typename Quirks> void OP_8xy3();
 
     //8xy4 - ADD Vx, Vy - Set Vx = Vy, set Vf = carry
     void OP_8xy4();
@@ -96,14 +238,14 @@ class CHIP8
     //8xy5 - SUB Vx, Vy - SET Vx = Vx - Vy, set VF = NOT borrow
     void OP_8xy5();
 
-    //8xy6 - SHR Vx - Set Vx = Vx SHR 1
-    void OP_8xy6();
+    //8xy6 - SHR Vx {, Vy} - Set Vx = Vx SHR 1
+    template <typename Quirks> void OP_8xy6();
 
     //8xy7 - SUBN Vx, Vy - Set Vx = Vy - Vx, set VF = NOT borrow
     void OP_8xy7();
 
     //8xyE - SHL Vx {, Vy} - Set Vx = Vx SHL 1
-    void OP_8xyE();
+    template <typename Quirks> void OP_8xyE();
 
     //9xy0, Skilp next Instruction if Vx != Vy
     void OP_9xy0();
@@ -112,13 +254,13 @@ class CHIP8
     void OP_Annn();
 
     //Bnnn - JP V0, addr - Jump to location nnn + V0
-    void OP_Bnnn();
+    template <typename Quirks> void OP_Bnnn();
 
     // Cxkk - RND Vx, byte - Set Vx = random byte AND kk
     void OP_Cxkk();
 
-    // Dxyn - DRW Vx, Vy, nibble - Display/draw sprite
-    void OP_Dxyn();
+    // Dxyn - DRW Vx, Vy, nibble - Display/draw sprite (Dxy0: 16x16)
+    template <typename Quirks> void OP_Dxyn();
 
 
     // Ex9E, ExA1 - Skip on key press/not pressed
@@ -126,18 +268,47 @@ class CHIP8
     void OP_ExA1();
 
 
+    // XO-CHIP
+    void OP_F000(); // F000 nnnn - I = 16-bit nnnn
+    void OP_Fn01(); // Select drawing planes n
+    void OP_F002(); // Load 16-byte audio pattern from memory[I]
+    void OP_Fx3A(); // Set pitch = Vx
+
     void OP_Fx07();
     void OP_Fx0A();
     void OP_Fx15();
     void OP_Fx18();
     void OP_Fx1E();
     void OP_Fx29();
+    void OP_Fx30(); // SUPER-CHIP: I = 8x10 digit for Vx
     void OP_Fx33();
-    void OP_Fx55();
-    void OP_Fx65();
+    template <typename Quirks> void OP_Fx55();
+    template <typename Quirks> void OP_Fx65();
+    void OP_Fx75(); // SUPER-CHIP: save V0..Vx to flags
+    void OP_Fx85(); // SUPER-CHIP: load V0..Vx from flags
 
     // helper functions
+    template <typename Quirks> void InstallQuirks();
+    template <typename Archive> void TransferState(Archive& archive);
+    template <typename Quirks> void DispatchSwitch(OpId id);
+    template <typename Quirks> void CycleFor();
+    template <typename Quirks> unsigned int CycleFusedFor(unsigned int limit);
+    template <typename Quirks, bool Breakpoints> RunResult RunLoop(unsigned int maxCycles, uint32_t stopMask,
+        std::bitset<65536> const* breakpoints);
+    template <typename Timing, typename Quirks> unsigned int RunFrameFor(unsigned int budget);
+
+    // Each engine's loop instantiated for the current profile, set by
+    // SetQuirks; runEntry is indexed by whether breakpoints are checked
+    void (CHIP8::*cycleEntry)(){};
+    unsigned int (CHIP8::*fusedEntry)(unsigned int){};
+    RunResult (CHIP8::*runEntry[2])(unsigned int, uint32_t, std::bitset<65536> const*){};
+    unsigned int (CHIP8::*fastFrameEntry)(unsigned int){};
+    unsigned int (CHIP8::*vipFrameEntry)(unsigned int){};
+    void (CHIP8::*dispatchEntry)(OpId){};
+
+    void SkipNext();
     void Table0();
+    void Table5();
     void Table8();
     void TableE();
     void TableF();
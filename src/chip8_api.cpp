@@ -0,0 +1,104 @@
+#include "chip8_api.h"
+#include "chip8.h"
+#include "timing.h"
+
+#include <memory>
+#include <new>
+
+struct chip8
+{
+    CHIP8 core;
+};
+
+uint32_t chip8_api_version(void)
+{
+    return CHIP8_API_VERSION;
+}
+
+chip8* chip8_create(void)
+{
+    return new (std::nothrow) chip8;
+}
+
+void chip8_destroy(chip8* machine)
+{
+    delete machine;
+}
+
+int chip8_load_rom_mem(chip8* machine, const uint8_t* data, size_t size, int quirks)
+{
+    if (quirks < CHIP8_QUIRKS_AUTO || quirks > CHIP8_QUIRKS_XOCHIP)
+    {
+        return 0;
+    }
+
+    // Reset everything but the generator, which the host may have seeded
+    std::minstd_rand randGen = machine->core.randGen;
+    std::unique_ptr<CHIP8> fresh(new (std::nothrow) CHIP8);
+    if (!fresh)
+    {
+        return 0;
+    }
+    machine->core = *fresh;
+    machine->core.randGen = randGen;
+
+    QuirkProfile profile = quirks == CHIP8_QUIRKS_AUTO ? QuirkProfile::SuperChip : static_cast<QuirkProfile>(quirks);
+    return machine->core.loadROM(data, size, nullptr, profile);
+}
+
+void chip8_seed(chip8* machine, uint32_t seed)
+{
+    machine->core.randGen.seed(seed);
+}
+
+void chip8_set_keys(chip8* machine, uint16_t keys)
+{
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        machine->core.keypad[i] = (keys >> i) & 1u;
+    }
+}
+
+uint32_t chip8_run_frame(chip8* machine, uint32_t cycles)
+{
+    return machine->core.RunFrame<FastTiming>(cycles);
+}
+
+void chip8_get_framebuffer(const chip8* machine, chip8_framebuffer* framebuffer)
+{
+    CHIP8 const& core = machine->core;
+
+    framebuffer->words = &core.video[0][0][0];
+    framebuffer->width = core.Width();
+    framebuffer->height = core.Height();
+    framebuffer->planes = CHIP8::PLANES;
+    framebuffer->row_words = 2;
+    framebuffer->plane_words = CHIP8::HIRES_HEIGHT * 2;
+}
+
+int chip8_take_draw(chip8* machine)
+{
+    bool drew = machine->core.drawFlag;
+    machine->core.drawFlag = false;
+    return drew;
+}
+
+int chip8_sound_active(const chip8* machine)
+{
+    return machine->core.soundTimer > 0;
+}
+
+size_t chip8_state_size(void)
+{
+    return CHIP8::StateSize();
+}
+
+int chip8_save_state(const chip8* machine, void* buffer, size_t size)
+{
+    return machine->core.SaveState(static_cast<uint8_t*>(buffer), size);
+}
+
+int chip8_load_state(chip8* machine, const void* buffer, size_t size)
+{
+    return machine->core.LoadState(static_cast<uint8_t const*>(buffer), size);
+}
@@ -0,0 +1,102 @@
+// chip8_api.h
+#pragma once
+
+// C interface to the emulator core for embedding, built as libchip8
+// (static or shared) without SDL. Everything goes through an opaque
+// handle; functions returning int give 1 on success and 0 on failure.
+//
+//   chip8* machine = chip8_create();
+//   chip8_load_rom_mem(machine, rom, size, CHIP8_QUIRKS_AUTO);
+//   for (;;) {
+//       chip8_set_keys(machine, keys);
+//       chip8_run_frame(machine, 15);
+//       chip8_get_framebuffer(machine, &fb);   // no copy, see below
+//   }
+//   chip8_destroy(machine);
+//
+// Defining CHIP8_SHARED when using the shared library imports the symbols
+// on Windows.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(CHIP8_SHARED)
+#  ifdef CHIP8_BUILD
+#    define CHIP8_API __declspec(dllexport)
+#  else
+#    define CHIP8_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__)
+#  define CHIP8_API __attribute__((visibility("default")))
+#else
+#  define CHIP8_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bumped when a signature or struct below changes incompatibly
+#define CHIP8_API_VERSION 1
+
+typedef struct chip8 chip8;
+
+// Quirk profiles, as in QuirkProfile
+#define CHIP8_QUIRKS_AUTO   (-1)
+#define CHIP8_QUIRKS_VIP    0
+#define CHIP8_QUIRKS_CHIP48 1
+#define CHIP8_QUIRKS_SCHIP  2
+#define CHIP8_QUIRKS_XOCHIP 3
+
+// The core's packed framebuffer, valid until the next call that runs the
+// machine. Plane p, row y is words[p * plane_words + y * row_words], two
+// 64-bit words of 128 pixels, x = 0 the most significant bit of the first.
+// Only the top-left width x height pixels are shown (64x32 or 128x64). A
+// pixel's colour index is (plane 1 bit << 1) | plane 0 bit.
+typedef struct chip8_framebuffer
+{
+    const uint64_t* words;
+    uint32_t width;
+    uint32_t height;
+    uint32_t planes;
+    uint32_t row_words;
+    uint32_t plane_words;
+} chip8_framebuffer;
+
+CHIP8_API uint32_t chip8_api_version(void);
+
+// NULL if out of memory
+CHIP8_API chip8* chip8_create(void);
+CHIP8_API void chip8_destroy(chip8* machine);
+
+// Loads at 0x200 into a freshly reset machine. quirks is a CHIP8_QUIRKS_*
+// value; AUTO uses SUPER-CHIP like the frontend does for .ch8 files.
+CHIP8_API int chip8_load_rom_mem(chip8* machine, const uint8_t* data, size_t size, int quirks);
+
+// Seeds Cxkk's generator, for reproducible runs
+CHIP8_API void chip8_seed(chip8* machine, uint32_t seed);
+
+// Bit n set holds key n down until the next call
+CHIP8_API void chip8_set_keys(chip8* machine, uint16_t keys);
+
+// Runs one 60 Hz frame of cycles instructions, then the timers. Returns
+// the instructions executed.
+CHIP8_API uint32_t chip8_run_frame(chip8* machine, uint32_t cycles);
+
+CHIP8_API void chip8_get_framebuffer(const chip8* machine, chip8_framebuffer* framebuffer);
+
+// 1 if a frame drew since the last call, which clears it
+CHIP8_API int chip8_take_draw(chip8* machine);
+
+// 1 while the sound timer runs
+CHIP8_API int chip8_sound_active(const chip8* machine);
+
+// Save states are chip8_state_size() bytes, portable between hosts and
+// standard libraries
+CHIP8_API size_t chip8_state_size(void);
+CHIP8_API int chip8_save_state(const chip8* machine, void* buffer, size_t size);
+CHIP8_API int chip8_load_state(chip8* machine, const void* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,189 @@
+#include "debugger.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+Debugger::Debugger(CHIP8& chip8, unsigned int cyclesPerFrame)
+    : chip8(chip8), cyclesPerFrame(cyclesPerFrame ? cyclesPerFrame : 1)
+{
+}
+
+// Addresses wrap like the core's stores do, at the profile's memory size
+void Debugger::SetWatchpoint(uint16_t address, uint16_t length, bool enabled)
+{
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        watchpoints[(address + i) & chip8.addressMask] = enabled;
+    }
+    anyWatchpoint = watchpoints.any();
+}
+
+void Debugger::WatchRegisters(uint32_t mask, bool enabled)
+{
+    watchedRegisters = enabled ? (watchedRegisters | mask) : (watchedRegisters & ~mask);
+}
+
+void Debugger::ClearAll()
+{
+    breakpoints.reset();
+    watchpoints.reset();
+    anyWatchpoint = false;
+    watchedRegisters = 0;
+}
+
+// Only the two store instructions are watched: Fx33 writes I..I+2,
+// Fx55 writes I..I+x
+bool Debugger::WritesWatched(uint16_t opcode)
+{
+    if ((opcode & 0xF000u) != 0xF000u)
+    {
+        return false;
+    }
+
+    unsigned int length;
+    switch (opcode & 0x00FFu)
+    {
+        case 0x33: length = 3; break;
+        case 0x55: length = ((opcode & 0x0F00u) >> 8u) + 1; break;
+        default: return false;
+    }
+
+    for (unsigned int i = 0; i < length; ++i)
+    {
+        uint16_t address = (chip8.index + i) & chip8.addressMask;
+        if (watchpoints[address])
+        {
+            watchAddress = address;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Debugger::Execute(StopReason& reason)
+{
+    uint16_t opcode = (chip8.memory[chip8.Pc] << 8u) | chip8.memory[(chip8.Pc + 1) & chip8.addressMask];
+
+    // Stops before the write, so the old contents can still be inspected
+    if (anyWatchpoint && WritesWatched(opcode))
+    {
+        reason = StopReason::Watchpoint;
+        return false;
+    }
+
+    uint8_t oldV[16];
+    uint16_t oldIndex = chip8.index;
+    std::memcpy(oldV, chip8.V, sizeof(oldV));
+
+    chip8.Cycle();
+    ++instructions;
+
+    if (++frameCycle == cyclesPerFrame)
+    {
+        frameCycle = 0;
+        chip8.UpdateTimers();
+    }
+
+    if (watchedRegisters)
+    {
+        uint32_t changed = (chip8.index != oldIndex) ? WATCH_INDEX : 0;
+        for (unsigned int i = 0; i < 16; ++i)
+        {
+            changed |= (chip8.V[i] != oldV[i]) << i;
+        }
+
+        changedRegisters = changed & watchedRegisters;
+        if (changedRegisters)
+        {
+            reason = StopReason::RegisterWatch;
+            return false;
+        }
+    }
+    return true;
+}
+
+Debugger::StopReason Debugger::Run(uint64_t maxInstructions, int targetDepth, uint64_t steps)
+{
+    StopReason reason;
+
+    for (uint64_t i = 0; i < maxInstructions; ++i)
+    {
+        // A breakpoint under the current Pc is stepped over, not hit again
+        if (i > 0 && breakpoints[chip8.Pc])
+        {
+            return StopReason::Breakpoint;
+        }
+
+        if (!Execute(reason))
+        {
+            return reason;
+        }
+
+        if ((int)chip8.sp < targetDepth || i + 1 == steps)
+        {
+            return StopReason::Step;
+        }
+    }
+    return StopReason::Limit;
+}
+
+Debugger::StopReason Debugger::Continue(uint64_t maxInstructions)
+{
+    if (anyWatchpoint || watchedRegisters)
+    {
+        return Run(maxInstructions, -1, 0);
+    }
+
+    // Only breakpoints to check: the core runs up to a frame per call
+    for (uint64_t done = 0; done < maxInstructions; )
+    {
+        // Run steps over a breakpoint under its starting Pc
+        if (done > 0 && breakpoints[chip8.Pc])
+        {
+            return StopReason::Breakpoint;
+        }
+
+        uint64_t budget = std::min<uint64_t>(cyclesPerFrame - frameCycle, maxInstructions - done);
+        CHIP8::RunResult result = chip8.Run((unsigned int)budget, CHIP8::STOP_BREAKPOINT, &breakpoints);
+
+        done += chip8.runCycles;
+        instructions += chip8.runCycles;
+        frameCycle += chip8.runCycles;
+
+        if (frameCycle == cyclesPerFrame)
+        {
+            frameCycle = 0;
+            chip8.UpdateTimers();
+        }
+
+        if (result == CHIP8::RunResult::Breakpoint)
+        {
+            return StopReason::Breakpoint;
+        }
+    }
+    return StopReason::Limit;
+}
+
+Debugger::StopReason Debugger::Step(uint64_t count)
+{
+    return Run(count, -1, count);
+}
+
+Debugger::StopReason Debugger::StepOver(uint64_t maxInstructions)
+{
+    uint16_t opcode = (chip8.memory[chip8.Pc] << 8u) | chip8.memory[(chip8.Pc + 1) & chip8.addressMask];
+
+    if ((opcode & 0xF000u) != 0x2000u)
+    {
+        return Step();
+    }
+
+    // The call returns once the stack is back to its current depth
+    return Run(maxInstructions, chip8.sp + 1, 0);
+}
+
+Debugger::StopReason Debugger::StepOut(uint64_t maxInstructions)
+{
+    return Run(maxInstructions, chip8.sp, 0);
+}
@@ -0,0 +1,69 @@
+// debugger.h
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+
+#include "chip8.h"
+
+// Breakpoints, watchpoints and stepping on top of a CHIP8. The debugger
+// drives the core through its own step loop and checks per-address bitmaps
+// there, so CHIP8::Cycle itself carries no debug branch. Without watches
+// Continue runs in CHIP8::Run, handing it the breakpoint bitmap.
+class Debugger
+{
+    public:
+        enum class StopReason
+        {
+            Step,           // requested step/step-over/step-out completed
+            Breakpoint,     // Pc reached a breakpoint
+            Watchpoint,     // Fx55/Fx33 is about to write a watched byte
+            RegisterWatch,  // a watched register changed
+            Limit           // instruction limit reached
+        };
+
+        // Register watch bits: V0-VF are bits 0-15, I is bit 16
+        static constexpr uint32_t WATCH_INDEX = 1u << 16;
+
+        explicit Debugger(CHIP8& chip8, unsigned int cyclesPerFrame);
+
+        void SetBreakpoint(uint16_t address, bool enabled) { breakpoints[address] = enabled; }
+        bool HasBreakpoint(uint16_t address) const { return breakpoints[address]; }
+        void SetWatchpoint(uint16_t address, uint16_t length, bool enabled);
+        void WatchRegisters(uint32_t mask, bool enabled);
+        void ClearAll();
+
+        // Each runs at most maxInstructions, timers tick every
+        // cyclesPerFrame instructions like the frame scheduler does
+        StopReason Continue(uint64_t maxInstructions);
+        StopReason Step(uint64_t count = 1);
+        StopReason StepOver(uint64_t maxInstructions);    // runs 2nnn calls to completion
+        StopReason StepOut(uint64_t maxInstructions);     // runs until the current 00EE returns
+
+        // What stopped the last run: the address written or registers changed
+        uint16_t WatchAddress() const { return watchAddress; }
+        uint32_t ChangedRegisters() const { return changedRegisters; }
+        uint64_t Instructions() const { return instructions; }
+
+    private:
+        // Runs until depth(sp) < targetDepth after an instruction, or a stop
+        // condition. Plain Step passes a target it can never reach.
+        StopReason Run(uint64_t maxInstructions, int targetDepth, uint64_t steps);
+
+        // Executes one instruction with watch checks, false if one fired
+        bool Execute(StopReason& reason);
+        bool WritesWatched(uint16_t opcode);
+
+        CHIP8& chip8;
+        unsigned int cyclesPerFrame;
+        unsigned int frameCycle{};
+
+        std::bitset<65536> breakpoints;
+        std::bitset<65536> watchpoints;
+        bool anyWatchpoint{};
+        uint32_t watchedRegisters{};
+
+        uint16_t watchAddress{};
+        uint32_t changedRegisters{};
+        uint64_t instructions{};
+};
@@ -0,0 +1,89 @@
+#include "decode.h"
+#include <cstdio>
+
+static char const* const opNames[] = {
+    "invalid",
+    "00E0", "00EE", "00Cn", "00FB", "00FC", "00FD", "00FE", "00FF",
+    "1nnn", "2nnn", "3xkk", "4xkk",
+    "5xy0", "5xy2", "5xy3",
+    "6xkk", "7xkk",
+    "8xy0", "8xy1", "8xy2", "8xy3", "8xy4", "8xy5", "8xy6", "8xy7", "8xyE",
+    "9xy0", "Annn", "Bnnn", "Cxkk", "Dxyn",
+    "Ex9E", "ExA1",
+    "F000", "Fn01", "F002", "Fx3A",
+    "Fx07", "Fx0A", "Fx15", "Fx18", "Fx1E", "Fx29", "Fx30", "Fx33",
+    "Fx55", "Fx65", "Fx75", "Fx85",
+};
+
+static_assert(sizeof(opNames) / sizeof(opNames[0]) == (size_t)OpId::Count, "one name per OpId");
+
+char const* OpName(OpId id)
+{
+    return id < OpId::Count ? opNames[(size_t)id] : "?";
+}
+
+std::string Disassemble(uint16_t opcode, uint16_t next)
+{
+    unsigned int x = (opcode & 0x0F00u) >> 8u;
+    unsigned int y = (opcode & 0x00F0u) >> 4u;
+    unsigned int n = opcode & 0x000Fu;
+    unsigned int kk = opcode & 0x00FFu;
+    unsigned int nnn = opcode & 0x0FFFu;
+
+    char text[32];
+
+    switch (Decode(opcode))
+    {
+        case OpId::Op00E0: return "CLS";
+        case OpId::Op00EE: return "RET";
+        case OpId::Op00Cn: std::snprintf(text, sizeof(text), "SCD %u", n); break;
+        case OpId::Op00FB: return "SCR";
+        case OpId::Op00FC: return "SCL";
+        case OpId::Op00FD: return "EXIT";
+        case OpId::Op00FE: return "LOW";
+        case OpId::Op00FF: return "HIGH";
+        case OpId::Op1nnn: std::snprintf(text, sizeof(text), "JP %03X", nnn); break;
+        case OpId::Op2nnn: std::snprintf(text, sizeof(text), "CALL %03X", nnn); break;
+        case OpId::Op3xkk: std::snprintf(text, sizeof(text), "SE V%X, %02X", x, kk); break;
+        case OpId::Op4xkk: std::snprintf(text, sizeof(text), "SNE V%X, %02X", x, kk); break;
+        case OpId::Op5xy0: std::snprintf(text, sizeof(text), "SE V%X, V%X", x, y); break;
+        case OpId::Op5xy2: std::snprintf(text, sizeof(text), "SAVE V%X-V%X", x, y); break;
+        case OpId::Op5xy3: std::snprintf(text, sizeof(text), "LOAD V%X-V%X", x, y); break;
+        case OpId::Op6xkk: std::snprintf(text, sizeof(text), "LD V%X, %02X", x, kk); break;
+        case OpId::Op7xkk: std::snprintf(text, sizeof(text), "ADD V%X, %02X", x, kk); break;
+        case OpId::Op8xy0: std::snprintf(text, sizeof(text), "LD V%X, V%X", x, y); break;
+        case OpId::Op8xy1: std::snprintf(text, sizeof(text), "OR V%X, V%X", x, y); break;
+        case OpId::Op8xy2: std::snprintf(text, sizeof(text), "AND V%X, V%X", x, y); break;
+        case OpId::Op8xy3: std::snprintf(text, sizeof(text), "XOR V%X, V%X", x, y); break;
+        case OpId::Op8xy4: std::snprintf(text, sizeof(text), "ADD V%X, V%X", x, y); break;
+        case OpId::Op8xy5: std::snprintf(text, sizeof(text), "SUB V%X, V%X", x, y); break;
+        case OpId::Op8xy6: std::snprintf(text, sizeof(text), "SHR V%X, V%X", x, y); break;
+        case OpId::Op8xy7: std::snprintf(text, sizeof(text), "SUBN V%X, V%X", x, y); break;
+        case OpId::Op8xyE: std::snprintf(text, sizeof(text), "SHL V%X, V%X", x, y); break;
+        case OpId::Op9xy0: std::snprintf(text, sizeof(text), "SNE V%X, V%X", x, y); break;
+        case OpId::OpAnnn: std::snprintf(text, sizeof(text), "LD I, %03X", nnn); break;
+        case OpId::OpBnnn: std::snprintf(text, sizeof(text), "JP V0, %03X", nnn); break;
+        case OpId::OpCxkk: std::snprintf(text, sizeof(text), "RND V%X, %02X", x, kk); break;
+        case OpId::OpDxyn: std::snprintf(text, sizeof(text), "DRW V%X, V%X, %u", x, y, n); break;
+        case OpId::OpEx9E: std::snprintf(text, sizeof(text), "SKP V%X", x); break;
+        case OpId::OpExA1: std::snprintf(text, sizeof(text), "SKNP V%X", x); break;
+        case OpId::OpF000: std::snprintf(text, sizeof(text), "LD I, long %04X", next); break;
+        case OpId::OpFn01: std::snprintf(text, sizeof(text), "PLANE %u", x); break;
+        case OpId::OpF002: return "AUDIO";
+        case OpId::OpFx3A: std::snprintf(text, sizeof(text), "PITCH V%X", x); break;
+        case OpId::OpFx07: std::snprintf(text, sizeof(text), "LD V%X, DT", x); break;
+        case OpId::OpFx0A: std::snprintf(text, sizeof(text), "LD V%X, K", x); break;
+        case OpId::OpFx15: std::snprintf(text, sizeof(text), "LD DT, V%X", x); break;
+        case OpId::OpFx18: std::snprintf(text, sizeof(text), "LD ST, V%X", x); break;
+        case OpId::OpFx1E: std::snprintf(text, sizeof(text), "ADD I, V%X", x); break;
+        case OpId::OpFx29: std::snprintf(text, sizeof(text), "LD F, V%X", x); break;
+        case OpId::OpFx30: std::snprintf(text, sizeof(text), "LD HF, V%X", x); break;
+        case OpId::OpFx33: std::snprintf(text, sizeof(text), "LD B, V%X", x); break;
+        case OpId::OpFx55: std::snprintf(text, sizeof(text), "LD [I], V%X", x); break;
+        case OpId::OpFx65: std::snprintf(text, sizeof(text), "LD V%X, [I]", x); break;
+        case OpId::OpFx75: std::snprintf(text, sizeof(text), "LD R, V%X", x); break;
+        case OpId::OpFx85: std::snprintf(text, sizeof(text), "LD V%X, R", x); break;
+        default: std::snprintf(text, sizeof(text), "DW %04X", opcode); break;
+    }
+    return text;
+}
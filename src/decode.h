@@ -0,0 +1,165 @@
+// decode.h
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Opcode identifiers, one per CHIP8 handler. Decode mirrors the dispatch
+// tables built in the CHIP8 constructor entry for entry (including which
+// bits they ignore), so tools see exactly what Cycle would execute.
+enum class OpId : uint8_t
+{
+    Invalid,        // OP_NULL
+    Op00E0, Op00EE, Op00Cn, Op00FB, Op00FC, Op00FD, Op00FE, Op00FF,
+    Op1nnn, Op2nnn, Op3xkk, Op4xkk,
+    Op5xy0, Op5xy2, Op5xy3,
+    Op6xkk, Op7xkk,
+    Op8xy0, Op8xy1, Op8xy2, Op8xy3, Op8xy4, Op8xy5, Op8xy6, Op8xy7, Op8xyE,
+    Op9xy0, OpAnnn, OpBnnn, OpCxkk, OpDxyn,
+    OpEx9E, OpExA1,
+    OpF000, OpFn01, OpF002, OpFx3A,
+    OpFx07, OpFx0A, OpFx15, OpFx18, OpFx1E, OpFx29, OpFx30, OpFx33,
+    OpFx55, OpFx65, OpFx75, OpFx85,
+    Count
+};
+
+constexpr OpId Decode(uint16_t opcode)
+{
+    uint8_t low = opcode & 0x00FFu;
+
+    switch (opcode >> 12u)
+    {
+        case 0x0:
+            if ((low & 0xF0u) == 0xC0u) return OpId::Op00Cn;
+            switch (low)
+            {
+                case 0xE0: return OpId::Op00E0;
+                case 0xEE: return OpId::Op00EE;
+                case 0xFB: return OpId::Op00FB;
+                case 0xFC: return OpId::Op00FC;
+                case 0xFD: return OpId::Op00FD;
+                case 0xFE: return OpId::Op00FE;
+                case 0xFF: return OpId::Op00FF;
+                default: return OpId::Invalid;
+            }
+        case 0x1: return OpId::Op1nnn;
+        case 0x2: return OpId::Op2nnn;
+        case 0x3: return OpId::Op3xkk;
+        case 0x4: return OpId::Op4xkk;
+        case 0x5:
+            switch (opcode & 0x000Fu)
+            {
+                case 0x0: return OpId::Op5xy0;
+                case 0x2: return OpId::Op5xy2;
+                case 0x3: return OpId::Op5xy3;
+                default: return OpId::Invalid;
+            }
+        case 0x6: return OpId::Op6xkk;
+        case 0x7: return OpId::Op7xkk;
+        case 0x8:
+            switch (opcode & 0x000Fu)
+            {
+                case 0x0: return OpId::Op8xy0;
+                case 0x1: return OpId::Op8xy1;
+                case 0x2: return OpId::Op8xy2;
+                case 0x3: return OpId::Op8xy3;
+                case 0x4: return OpId::Op8xy4;
+                case 0x5: return OpId::Op8xy5;
+                case 0x6: return OpId::Op8xy6;
+                case 0x7: return OpId::Op8xy7;
+                case 0xE: return OpId::Op8xyE;
+                default: return OpId::Invalid;
+            }
+        case 0x9: return OpId::Op9xy0;
+        case 0xA: return OpId::OpAnnn;
+        case 0xB: return OpId::OpBnnn;
+        case 0xC: return OpId::OpCxkk;
+        case 0xD: return OpId::OpDxyn;
+        case 0xE:
+            // The table is indexed by the low nibble only
+            switch (opcode & 0x000Fu)
+            {
+                case 0x1: return OpId::OpExA1;
+                case 0xE: return OpId::OpEx9E;
+                default: return OpId::Invalid;
+            }
+        default:
+            switch (low)
+            {
+                case 0x00: return opcode == 0xF000 ? OpId::OpF000 : OpId::Invalid;
+                case 0x01: return OpId::OpFn01;
+                case 0x02: return OpId::OpF002;
+                case 0x07: return OpId::OpFx07;
+                case 0x0A: return OpId::OpFx0A;
+                case 0x15: return OpId::OpFx15;
+                case 0x18: return OpId::OpFx18;
+                case 0x1E: return OpId::OpFx1E;
+                case 0x29: return OpId::OpFx29;
+                case 0x30: return OpId::OpFx30;
+                case 0x33: return OpId::OpFx33;
+                case 0x3A: return OpId::OpFx3A;
+                case 0x55: return OpId::OpFx55;
+                case 0x65: return OpId::OpFx65;
+                case 0x75: return OpId::OpFx75;
+                case 0x85: return OpId::OpFx85;
+                default: return OpId::Invalid;
+            }
+    }
+}
+
+// Instruction size in bytes: F000 carries a 16-bit address after it
+constexpr unsigned int InstructionLength(OpId id)
+{
+    return id == OpId::OpF000 ? 4 : 2;
+}
+
+// Conditional skips over the next instruction
+constexpr bool IsSkip(OpId id)
+{
+    return id == OpId::Op3xkk || id == OpId::Op4xkk || id == OpId::Op5xy0
+        || id == OpId::Op9xy0 || id == OpId::OpEx9E || id == OpId::OpExA1;
+}
+
+// Every opcode's OpId, so decoding is a single byte load. Built at compile
+// time from Decode; an id depends only on the top nibble and the low byte
+// (F000 aside, the only opcode with a fixed middle nibble), so Decode runs
+// 4096 times and the middle nibble just repeats the result (which also
+// keeps the build within clang's constexpr step limit).
+struct DecodeLut
+{
+    OpId ids[65536];
+};
+
+constexpr DecodeLut MakeDecodeLut()
+{
+    DecodeLut lut{};
+
+    for (unsigned int high = 0; high < 16; ++high)
+    {
+        for (unsigned int low = 0; low < 256; ++low)
+        {
+            OpId id = Decode((uint16_t)((high << 12u) | low));
+
+            for (unsigned int middle = 0; middle < 16; ++middle)
+            {
+                uint16_t opcode = (uint16_t)((high << 12u) | (middle << 8u) | low);
+                lut.ids[opcode] = (high == 0xF && low == 0x00) ? Decode(opcode) : id;
+            }
+        }
+    }
+    return lut;
+}
+
+inline constexpr DecodeLut DECODE_LUT = MakeDecodeLut();
+
+static_assert(DECODE_LUT.ids[0xF355] == OpId::OpFx55 && DECODE_LUT.ids[0x8ABF] == OpId::Invalid
+    && DECODE_LUT.ids[0xF000] == OpId::OpF000 && DECODE_LUT.ids[0xF100] == OpId::Invalid,
+    "decode table disagrees with Decode");
+
+// Opcode pattern as written in the handler names, e.g. "Dxyn", for
+// profiles and statistics
+char const* OpName(OpId id);
+
+// Assembly text, Cowgod/SUPER-CHIP style mnemonics. next is the word after
+// the opcode, only used by F000.
+std::string Disassemble(uint16_t opcode, uint16_t next = 0);
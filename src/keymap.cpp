@@ -0,0 +1,154 @@
+#include "keymap.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+
+KeyMap::KeyMap()
+{
+    static const SDL_Scancode defaults[16] = {
+        SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3, // 0 1 2 3
+        SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A, // 4 5 6 7
+        SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C, // 8 9 A B
+        SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V  // C D E F
+    };
+
+    Clear();
+    for (uint8_t key = 0; key < 16; ++key)
+    {
+        Bind(defaults[key], key);
+    }
+
+    // Most games steer with 5/7/8/9 and act with 4/6
+    BindButton(SDL_GAMEPAD_BUTTON_DPAD_UP, 0x5);
+    BindButton(SDL_GAMEPAD_BUTTON_DPAD_LEFT, 0x7);
+    BindButton(SDL_GAMEPAD_BUTTON_DPAD_DOWN, 0x8);
+    BindButton(SDL_GAMEPAD_BUTTON_DPAD_RIGHT, 0x9);
+    BindButton(SDL_GAMEPAD_BUTTON_SOUTH, 0x6);
+    BindButton(SDL_GAMEPAD_BUTTON_EAST, 0x4);
+    BindButton(SDL_GAMEPAD_BUTTON_WEST, 0xA);
+    BindButton(SDL_GAMEPAD_BUTTON_NORTH, 0xB);
+    BindButton(SDL_GAMEPAD_BUTTON_START, 0xF);
+}
+
+void KeyMap::Clear()
+{
+    for (int i = 0; i < SDL_SCANCODE_COUNT; ++i)
+    {
+        table[i] = UNBOUND;
+    }
+    for (int i = 0; i < SDL_GAMEPAD_BUTTON_COUNT; ++i)
+    {
+        buttons[i] = UNBOUND;
+    }
+}
+
+void KeyMap::Bind(SDL_Scancode scancode, uint8_t key)
+{
+    table[scancode] = key & 0xFu;
+}
+
+void KeyMap::Unbind(SDL_Scancode scancode)
+{
+    table[scancode] = UNBOUND;
+}
+
+void KeyMap::BindButton(SDL_GamepadButton button, uint8_t key)
+{
+    buttons[button] = key & 0xFu;
+}
+
+void KeyMap::UnbindButton(SDL_GamepadButton button)
+{
+    buttons[button] = UNBOUND;
+}
+
+// File format: '[name]' starts a layout, then one '<key> <scancode name>'
+// binding per line, key in hex (0-F), name as given by SDL_GetScancodeName.
+// Gamepad buttons are bound with '<key> pad <button>', button as given by
+// SDL_GetGamepadStringForButton. '#' starts a comment. A key may be bound
+// to several scancodes and buttons.
+bool KeyMap::Load(const char* filename, const char* layout)
+{
+    std::ifstream file(filename);
+
+    if (!file.is_open())
+    {
+        std::cerr << "Error: Could not open keymap " << filename << "\n";
+        return false;
+    }
+
+    std::string line;
+    std::string section;
+    bool found = false;
+    int lineNumber = 0;
+
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+
+        line = line.substr(0, line.find('#'));
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos)
+        {
+            continue;
+        }
+        line = line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+
+        if (line[0] == '[')
+        {
+            section = line.substr(1, line.find(']') - 1);
+            if (section == layout)
+            {
+                found = true;
+                Clear();
+            }
+            continue;
+        }
+
+        if (section != layout)
+        {
+            continue;
+        }
+
+        size_t split = line.find_first_of(" \t");
+        size_t nameStart = (split == std::string::npos) ? split : line.find_first_not_of(" \t", split);
+        char* end = nullptr;
+        long key = std::strtol(line.c_str(), &end, 16);
+        if (nameStart == std::string::npos || end != line.c_str() + split || key < 0 || key > 0xF)
+        {
+            std::cerr << "Error: " << filename << ":" << lineNumber << ": expected '<key> <scancode>'\n";
+            return false;
+        }
+
+        std::string name = line.substr(nameStart);
+        if (name.compare(0, 4, "pad ") == 0)
+        {
+            SDL_GamepadButton button = SDL_GetGamepadButtonFromString(name.c_str() + 4);
+            if (button == SDL_GAMEPAD_BUTTON_INVALID)
+            {
+                std::cerr << "Error: " << filename << ":" << lineNumber << ": unknown button '"
+                    << name.substr(4) << "'\n";
+                return false;
+            }
+            BindButton(button, (uint8_t)key);
+            continue;
+        }
+
+        SDL_Scancode scancode = SDL_GetScancodeFromName(name.c_str());
+        if (scancode == SDL_SCANCODE_UNKNOWN)
+        {
+            std::cerr << "Error: " << filename << ":" << lineNumber << ": unknown key '"
+                << name << "'\n";
+            return false;
+        }
+        Bind(scancode, (uint8_t)key);
+    }
+
+    if (!found)
+    {
+        std::cerr << "Error: No layout [" << layout << "] in " << filename << "\n";
+    }
+    return found;
+}
@@ -0,0 +1,41 @@
+// keymap.h
+#include <SDL3/SDL.h>
+#pragma once
+
+#include <cstdint>
+
+// Scancode/gamepad button -> CHIP-8 key lookup tables. Scancodes are
+// physical key positions, so the same binding works whatever the OS
+// keyboard layout.
+class KeyMap
+{
+    public:
+        static constexpr int8_t UNBOUND = -1;
+
+        KeyMap(); // built-in 1234/QWER/ASDF/ZXCV block, d-pad on 5/7/8/9
+
+        // Loads the [layout] section of a keymap config file, replacing
+        // the current bindings. Returns false if the file or section is
+        // missing or a line cannot be parsed.
+        bool Load(const char* filename, const char* layout);
+
+        void Bind(SDL_Scancode scancode, uint8_t key);
+        void Unbind(SDL_Scancode scancode);
+        void BindButton(SDL_GamepadButton button, uint8_t key);
+        void UnbindButton(SDL_GamepadButton button);
+        void Clear();
+
+        int8_t Lookup(SDL_Scancode scancode) const
+        {
+            return table[scancode];
+        }
+
+        int8_t LookupButton(uint8_t button) const
+        {
+            return button < SDL_GAMEPAD_BUTTON_COUNT ? buttons[button] : UNBOUND;
+        }
+
+    private:
+        int8_t table[SDL_SCANCODE_COUNT];
+        int8_t buttons[SDL_GAMEPAD_BUTTON_COUNT];
+};
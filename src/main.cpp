@@ -1,58 +1,477 @@
 // Nasry Sami
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <chrono>
+#include <cmath>
 #include <iostream>
 #include <string>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
 
+#include "audio.h"
 #include "platform.h"
 #include "chip8.h"
+#include "trace.h"
+#include "triple_buffer.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Speed for ROMs the database does not know
+static constexpr int DEFAULT_CYCLES_PER_FRAME = 11;
+
+struct Frame
+{
+    uint64_t video[CHIP8::PLANES][CHIP8::HIRES_HEIGHT][2]; // packed, see CHIP8::video
+    bool hires;
+    Clock::time_point drawTime; // when the Dxyn/00E0 producing it ran
+
+    unsigned int Width() const { return hires ? CHIP8::HIRES_WIDTH : CHIP8::VIDEO_WIDTH; }
+    unsigned int Height() const { return hires ? CHIP8::HIRES_HEIGHT : CHIP8::VIDEO_HEIGHT; }
+};
+
+// Colour per (plane 1, plane 0) bit pair; 0 and 1 keep the CHIP-8 look
+static const uint32_t palette[4] = { 0x00000000, 0xFFFFFFFF, 0xAAAAAAFF, 0x555555FF };
+
+// Packed planes are composited to RGBA only here, written straight to the
+// destination (normally the locked texture)
+static void ExpandFrame(Frame const& frame, uint32_t* pixels, int pitch)
+{
+    for (unsigned int y = 0; y < frame.Height(); ++y)
+    {
+        uint32_t* out = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(pixels) + y * pitch);
+        uint64_t const* plane0 = frame.video[0][y];
+        uint64_t const* plane1 = frame.video[1][y];
+
+        for (unsigned int x = 0; x < frame.Width(); ++x)
+        {
+            unsigned int shift = 63 - (x & 63);
+            unsigned int colour = ((plane0[x >> 6] >> shift) & 1u) | (((plane1[x >> 6] >> shift) & 1u) << 1);
+            out[x] = palette[colour];
+        }
+    }
+}
+
+struct LatencyStats
+{
+    static constexpr double FRAME_MS = 1000.0 / 60.0;
+
+    uint64_t count{}, withinFrame{};
+    double sum{}, max{};
+
+    void Add(double ms)
+    {
+        sum += ms;
+        max = std::max(max, ms);
+        withinFrame += (ms <= FRAME_MS);
+        ++count;
+    }
+
+    void Print(char const* label) const
+    {
+        if (count)
+        {
+            std::cout << label << " latency: avg " << sum / count << " ms, max " << max
+                << " ms, " << withinFrame << "/" << count << " within one frame\n";
+        }
+    }
+};
 
 int main(int argc, char* argv[])
 {
-    if (argc != 4)
+    // ROM first, everything else optional; the old positional
+    // '<Scale> <Delay> <ROM>' form is still accepted
+    int first = 1;
+    bool legacy = argc >= 4 && std::isdigit((unsigned char)argv[1][0]) && std::isdigit((unsigned char)argv[2][0]);
+    if (legacy)
+    {
+        first = 3;
+    }
+
+    if (argc <= first)
+    {
+        std::cerr << "Usage: " << argv[0] << " <ROM> [--scale <n>] [--ipf <cycles per frame>]"
+            " [--romdb <file>] [--upload copy|lock] [--keymap <file>] [--layout <name>]"
+            " [--quirks vip|chip48|schip|xochip] [--trace <file>] [--seed <n>] [--record <movie file>]\n";
+        return EXIT_FAILURE;
+    }
+
+    int videoScale = legacy ? std::stoi(argv[1]) : 10;
+    int cyclesPerFrame = 0; // 0 = from the ROM database
+    char const* romFilename = argv[first];
+
+    if (legacy)
+    {
+        int cycleDelay = std::stoi(argv[2]);
+        cyclesPerFrame = cycleDelay > 0 ? std::max(1, (int)std::lround(1000.0 / 60.0 / cycleDelay)) : 1000;
+    }
+
+    // "copy" keeps the SDL_UpdateTexture path so both can be timed
+    bool lockUpload = true;
+    char const* romdbFilename = "romdb.bin";
+    char const* keymapFilename = nullptr;
+    char const* layout = nullptr;
+    char const* quirkName = nullptr;
+    char const* traceFilename = nullptr;
+    char const* recordFilename = nullptr;
+    unsigned long seed = (unsigned long)Clock::now().time_since_epoch().count();
+
+    for (int i = first + 1; i < argc; i += 2)
     {
-        std::cerr << "Usage: " << argv[0] << "<Scale> <Delay> <ROM>\n";
+        if (i + 1 == argc)
+        {
+            std::cerr << "Error: Missing value for " << argv[i] << "\n";
+            return EXIT_FAILURE;
+        }
+
+        if (std::strcmp(argv[i], "--scale") == 0)
+        {
+            videoScale = std::stoi(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--ipf") == 0)
+        {
+            cyclesPerFrame = std::stoi(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--romdb") == 0)
+        {
+            romdbFilename = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--upload") == 0)
+        {
+            lockUpload = std::strcmp(argv[i + 1], "copy") != 0;
+        }
+        else if (std::strcmp(argv[i], "--keymap") == 0)
+        {
+            keymapFilename = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--layout") == 0)
+        {
+            layout = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--quirks") == 0)
+        {
+            quirkName = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--trace") == 0)
+        {
+            traceFilename = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0)
+        {
+            seed = std::stoul(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--record") == 0)
+        {
+            recordFilename = argv[i + 1];
+        }
+        else
+        {
+            std::cerr << "Error: Unknown option " << argv[i] << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    // A missing database only means every ROM gets the defaults
+    RomDatabase romdb;
+    romdb.Open(romdbFilename);
+
+    CHIP8 chip8;
+    if (!chip8.loadROM(romFilename, &romdb)) {
+        std::cerr << "Error: Could not load ROM " << romFilename << "\n";
         return EXIT_FAILURE;
     }
 
-    int videoScale = std::stoi(argv[1]);
-    int cycleDelay = std::stoi(argv[2]);
-    char const* romFilename = argv[3];
+    RomInfo const* info = chip8.romInfo;
+    if (info)
+    {
+        std::cout << "ROM: " << info->title << " (" << QuirkProfileName(chip8.quirks)
+            << ", " << info->cyclesPerFrame << " cycles/frame)\n";
+
+        if (!cyclesPerFrame)
+        {
+            cyclesPerFrame = info->cyclesPerFrame;
+        }
+        if (!layout && info->layout[0])
+        {
+            layout = info->layout;
+        }
+    }
+    if (cyclesPerFrame <= 0)
+    {
+        cyclesPerFrame = DEFAULT_CYCLES_PER_FRAME;
+    }
+    if (!layout)
+    {
+        layout = "default";
+    }
+
+    // A named layout without an explicit file comes from the stock config
+    if (!keymapFilename && std::strcmp(layout, "default") != 0)
+    {
+        keymapFilename = "keymap.cfg";
+    }
+
+    KeyMap keymap;
+    if (keymapFilename && !keymap.Load(keymapFilename, layout))
+    {
+        return EXIT_FAILURE;
+    }
 
     Platform platform(
-        "CHIP-8 Emulator", 
-        CHIP8::VIDEO_WIDTH * videoScale, 
-        CHIP8::VIDEO_HEIGHT * videoScale, 
-        CHIP8::VIDEO_WIDTH, 
+        "CHIP-8 Emulator",
+        CHIP8::VIDEO_WIDTH * videoScale,
+        CHIP8::VIDEO_HEIGHT * videoScale,
+        CHIP8::VIDEO_WIDTH,
         CHIP8::VIDEO_HEIGHT
     );
 
-    CHIP8 chip8;
-    if (!chip8.loadROM(romFilename)) {
-        std::cerr << "Error: Could not load ROM " << romFilename << "\n";
+    platform.SetKeyMap(keymap);
+
+    Audio audio;
+
+    // loadROM picks a profile from the file type, the user can override it
+    if (quirkName)
+    {
+        QuirkProfile profile;
+        if (!ParseQuirkProfile(quirkName, profile))
+        {
+            std::cerr << "Error: Unknown quirk profile " << quirkName << "\n";
+            return EXIT_FAILURE;
+        }
+        chip8.SetQuirks(profile);
+    }
+
+    TraceRecorder trace;
+    if (traceFilename && !trace.Open(traceFilename, chip8.romHash))
+    {
         return EXIT_FAILURE;
     }
 
-    int videoPitch = sizeof(chip8.video[0]) * CHIP8::VIDEO_WIDTH;
-    auto lastCycleTime = std::chrono::high_resolution_clock::now();
-    bool quit = false;
+    chip8.randGen.seed(seed);
+
+    // The keypad state of every frame it changes on, as a movie (movie.h);
+    // with the seed and speed in the header it replays the session exactly
+    std::ofstream record;
+    if (recordFilename)
+    {
+        record.open(recordFilename);
+        if (!record.is_open())
+        {
+            std::cerr << "Error: Could not open " << recordFilename << "\n";
+            return EXIT_FAILURE;
+        }
+        record << "# " << romFilename << " --quirks " << QuirkProfileName(chip8.quirks)
+            << " --ipf " << cyclesPerFrame << " --seed " << seed << "\n";
+    }
+
+    std::atomic<bool> quit{false};
+    InputQueue input;
+    LatencyStats presentLatency, inputLatency, keyboardReadLatency, gamepadReadLatency;
+    TripleBuffer<Frame> frames;
+
+    // Publish the blank screen so there is something to present at start
+    frames.Back().drawTime = Clock::now();
+    frames.Publish();
+
+    // The scheduler runs in 60 Hz frames: a batch of instructions, then
+    // timers and one frame of audio.
+    auto const frameDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / 60.0));
 
+    // Emulation runs on its own thread so a blocking present (vsync) can
+    // never stall it; the main thread keeps SDL events and rendering.
+    std::thread emulation([&]() {
+        auto nextFrame = Clock::now();
+        uint16_t keys = 0, frameKeys = 0, pendingKeys = 0;
+        Uint64 pendingSince[16]{};
+        bool pendingGamepad[16]{};
+        uint64_t frameNumber = 0;
 
-    while (!quit)
+        // Latency probe: time from the physical transition until the ROM
+        // first observes that key through Ex9E/ExA1/Fx0A
+        auto probeKeyReads = [&]() {
+            uint16_t seen = chip8.keyReads & pendingKeys;
+            if (!seen)
+            {
+                return;
+            }
+
+            Uint64 now = SDL_GetTicksNS();
+            for (unsigned int i = 0; i < 16; ++i)
+            {
+                if (seen & (1u << i))
+                {
+                    double ms = (now - pendingSince[i]) / 1e6;
+                    (pendingGamepad[i] ? gamepadReadLatency : keyboardReadLatency).Add(ms);
+                }
+            }
+            pendingKeys &= ~seen;
+        };
+
+        while (!quit.load(std::memory_order_relaxed))
+        {
+            Clock::time_point drawTime{};
+
+            // Input is applied at frame boundaries only, so what the ROM
+            // sees depends on the frame an event arrives in, not on which
+            // instruction was running. A key pressed and released within
+            // the frame is still held for it.
+            uint16_t tapped = 0;
+            KeyEvent event;
+            while (input.Pop(event))
+            {
+                uint16_t changed = event.keys ^ keys;
+                tapped |= event.keys & changed;
+                keys = event.keys;
+
+                for (unsigned int i = 0; i < 16; ++i)
+                {
+                    if (changed & (1u << i))
+                    {
+                        pendingSince[i] = event.timestamp;
+                        pendingGamepad[i] = event.gamepad;
+                    }
+                }
+                pendingKeys |= changed;
+
+                inputLatency.Add((SDL_GetTicksNS() - event.timestamp) / 1e6);
+            }
+
+            if ((keys | tapped) != frameKeys || frameNumber == 0)
+            {
+                frameKeys = keys | tapped;
+                for (unsigned int i = 0; i < 16; ++i)
+                {
+                    chip8.keypad[i] = (frameKeys >> i) & 1u;
+                }
+                chip8.keyReads = 0;
+
+                if (record.is_open())
+                {
+                    char line[32];
+                    std::snprintf(line, sizeof(line), "%llu %04x\n", (unsigned long long)frameNumber, frameKeys);
+                    record << line;
+                }
+            }
+
+            if (trace.IsOpen())
+            {
+                // Tracing records every instruction, so it steps one at a time
+                for (int cycle = 0; cycle < cyclesPerFrame; ++cycle)
+                {
+                    uint16_t pc = chip8.Pc;
+                    uint16_t opcode = (chip8.memory[pc] << 8u) | chip8.memory[(pc + 1) & chip8.addressMask];
+
+                    chip8.Cycle();
+                    trace.Record(pc, opcode, chip8);
+                    probeKeyReads();
+
+                    if (chip8.drawFlag && drawTime == Clock::time_point{})
+                    {
+                        drawTime = Clock::now();
+                    }
+                }
+            }
+            else
+            {
+                // One batch up to the frame's first draw, which is the moment
+                // presentation latency is measured from, then the rest of the
+                // frame through the superinstructions
+                unsigned int remaining = cyclesPerFrame;
+
+                if (chip8.Run(remaining, CHIP8::STOP_DRAW) == CHIP8::RunResult::Draw)
+                {
+                    drawTime = Clock::now();
+                }
+                remaining -= chip8.runCycles;
+
+                while (remaining)
+                {
+                    remaining -= chip8.CycleFused(remaining);
+                }
+                probeKeyReads();
+            }
+
+            chip8.UpdateTimers();
+            audio.QueueFrame(chip8.soundTimer > 0, chip8.pattern, chip8.pitch);
+
+            // Only complete frames are handed to the presenter
+            if (chip8.drawFlag)
+            {
+                chip8.drawFlag = false;
+
+                Frame& frame = frames.Back();
+                std::memcpy(frame.video, chip8.video, sizeof(frame.video));
+                frame.hires = chip8.hires;
+                frame.drawTime = drawTime;
+                frames.Publish();
+            }
+
+            ++frameNumber;
+            nextFrame += frameDuration;
+            auto now = Clock::now();
+            if (now - nextFrame > 4 * frameDuration)
+            {
+                nextFrame = now; // fell far behind, don't try to catch up
+            }
+            std::this_thread::sleep_until(nextFrame);
+        }
+    });
+
+    bool textureHires = false;
+    static uint32_t staging[CHIP8::HIRES_WIDTH * CHIP8::HIRES_HEIGHT];
+
+    while (!quit.load(std::memory_order_relaxed))
     {
-        quit = platform.ProcessInput(chip8.keypad);
+        if (platform.ProcessInput(input))
+        {
+            quit.store(true);
+        }
+
+        if (!frames.Acquire())
+        {
+            SDL_Delay(1);
+            continue;
+        }
 
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float dt = std::chrono::duration<float, std::chrono::milliseconds::period>(currentTime - lastCycleTime).count();
+        Frame const& frame = frames.Front();
 
-        if (dt > cycleDelay)
+        // SUPER-CHIP mode switch: swap the texture, keep the renderer
+        if (frame.hires != textureHires)
         {
-            lastCycleTime = currentTime;
-            
-            chip8.Cycle();
-            platform.update(chip8.video, videoPitch);
+            textureHires = frame.hires;
+            platform.Resize(frame.Width(), frame.Height());
         }
+
+        platform.BeginUpload();
+        if (lockUpload)
+        {
+            int pitch;
+            uint32_t* pixels = platform.Lock(&pitch);
+            if (pixels)
+            {
+                ExpandFrame(frame, pixels, pitch);
+                platform.Unlock();
+            }
+            platform.Present();
+        }
+        else
+        {
+            int pitch = sizeof(staging[0]) * frame.Width();
+            ExpandFrame(frame, staging, pitch);
+            platform.update(staging, pitch);
+        }
+
+        presentLatency.Add(std::chrono::duration<double, std::milli>(Clock::now() - frame.drawTime).count());
     }
 
+    emulation.join();
+
+    presentLatency.Print("Draw to present");
+    inputLatency.Print("Input event to emulation");
+    keyboardReadLatency.Print("Keyboard to Ex9E/ExA1");
+    gamepadReadLatency.Print("Gamepad to Ex9E/ExA1");
+
     return 0;
-}   
\ No newline at end of file
+}
@@ -0,0 +1,66 @@
+#include "movie.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+
+bool LoadMovie(const char* filename, std::vector<MovieEntry>& movie)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        std::cerr << "Error: Could not open " << filename << "\n";
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        MovieEntry entry;
+        if (fields >> entry.frame >> std::hex >> entry.keys)
+        {
+            movie.push_back(entry);
+        }
+    }
+
+    std::stable_sort(movie.begin(), movie.end(),
+        [](MovieEntry const& a, MovieEntry const& b) { return a.frame < b.frame; });
+    return true;
+}
+
+std::vector<MovieEntry> DefaultMovie(uint64_t frames)
+{
+    std::vector<MovieEntry> movie;
+    uint32_t state = 0x12345678;
+
+    for (uint64_t frame = 0; frame < frames; frame += 8)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        uint16_t keys = 0;
+        if (state % 3)
+        {
+            keys = (1u << (state >> 8 & 0xF)) | ((state & 4) ? 1u << (state >> 16 & 0xF) : 0);
+        }
+        movie.push_back({frame, keys});
+    }
+    return movie;
+}
+
+size_t ApplyMovie(std::vector<MovieEntry> const& movie, size_t next, uint64_t frame, uint8_t* keypad)
+{
+    while (next < movie.size() && movie[next].frame <= frame)
+    {
+        for (unsigned int i = 0; i < 16; ++i)
+        {
+            keypad[i] = (movie[next].keys >> i) & 1u;
+        }
+        ++next;
+    }
+    return next;
+}
@@ -0,0 +1,25 @@
+// movie.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Recorded keypad input: '<frame> <hex keypad mask>' lines, '#' starts a
+// comment. Each mask is held from its frame until the next entry.
+struct MovieEntry
+{
+    uint64_t frame;
+    uint16_t keys;
+};
+
+// Appends the file's entries to movie, sorted by frame
+bool LoadMovie(const char* filename, std::vector<MovieEntry>& movie);
+
+// Fixed pseudo-random input for frames frames: mostly releases, otherwise
+// a key or two every 8 frames, so Ex9E/ExA1/Fx0A paths get exercised
+std::vector<MovieEntry> DefaultMovie(uint64_t frames);
+
+// Sets keypad from every entry due by frame, starting at next; returns the
+// index of the first entry still to come
+size_t ApplyMovie(std::vector<MovieEntry> const& movie, size_t next, uint64_t frame, uint8_t* keypad);
@@ -5,7 +5,7 @@
 Platform::Platform(char const* title, int windowWidth, int windowHeight, int textureWidth, 
         int textureHeight)
 {
-    SDL_Init(SDL_INIT_VIDEO);
+    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMEPAD);
 
     window = SDL_CreateWindow(title, windowWidth, windowHeight,0);
 
@@ -17,16 +17,79 @@ Platform::Platform(char const* title, int windowWidth, int windowHeight, int tex
 
 }
 
+void Platform::SetKeyMap(KeyMap const& map)
+{
+    keymap = map;
+}
+
 Platform::~Platform() {
+    double freq = (double)SDL_GetPerformanceFrequency() / 1000000.0;
+
+    if (copyFrames)
+    {
+        SDL_Log("UpdateTexture upload: %.2f us/frame over %llu frames",
+            copyTicks / freq / copyFrames, (unsigned long long)copyFrames);
+    }
+    if (lockFrames)
+    {
+        SDL_Log("LockTexture upload: %.2f us/frame over %llu frames",
+            lockTicks / freq / lockFrames, (unsigned long long)lockFrames);
+    }
+    if (mergedEvents)
+    {
+        SDL_Log("Input queue full: %llu key transitions merged into later ones",
+            (unsigned long long)mergedEvents);
+    }
+
     SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
+void Platform::BeginUpload()
+{
+    uploadStart = SDL_GetPerformanceCounter();
+}
+
 void Platform::update(void const* buffer, int pitch)
 {
     SDL_UpdateTexture(texture, nullptr, (const Uint8*)buffer, pitch);
+    copyTicks += SDL_GetPerformanceCounter() - uploadStart;
+    ++copyFrames;
+
+    Present();
+}
+
+uint32_t* Platform::Lock(int* pitch)
+{
+    void* pixels = nullptr;
+
+    if (!SDL_LockTexture(texture, nullptr, &pixels, pitch))
+    {
+        return nullptr;
+    }
+    return static_cast<uint32_t*>(pixels);
+}
+
+void Platform::Unlock()
+{
+    SDL_UnlockTexture(texture);
+    lockTicks += SDL_GetPerformanceCounter() - uploadStart;
+    ++lockFrames;
+}
+
+void Platform::Resize(int textureWidth, int textureHeight)
+{
+    SDL_DestroyTexture(texture);
+
+    texture = SDL_CreateTexture(
+        renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, textureWidth, textureHeight);
+    SDL_SetTextureScaleMode(texture, SDL_SCALEMODE_NEAREST);
+}
+
+void Platform::Present()
+{
     SDL_RenderClear(renderer);
 
     SDL_RenderTexture(renderer, texture, nullptr, nullptr);
@@ -34,60 +97,84 @@ void Platform::update(void const* buffer, int pitch)
     SDL_RenderPresent(renderer);
 }
 
-bool Platform::ProcessInput(uint8_t* keys)
+// Shared fast path for every input device: table lookup, mask update and
+// one queued state per transition
+void Platform::SetKey(uint16_t& mask, int8_t key, bool down, Uint64 timestamp,
+        bool gamepad, InputQueue& events)
+{
+    if (key == KeyMap::UNBOUND)
+    {
+        return;
+    }
+
+    uint16_t bit = 1u << key;
+    mask = down ? (mask | bit) : (mask & ~bit);
+    QueueState(timestamp, gamepad, events);
+}
+
+void Platform::QueueState(Uint64 timestamp, bool gamepad, InputQueue& events)
+{
+    if (unsent)
+    {
+        ++mergedEvents;
+    }
+
+    uint16_t keys = keyboardMask;
+    for (auto const& pad : gamepadMasks)
+    {
+        keys |= pad.second;
+    }
+
+    unsentEvent = {timestamp, keys, gamepad};
+    unsent = !events.Push(unsentEvent);
+}
+
+bool Platform::ProcessInput(InputQueue& events)
 {
     bool quit = false;
 
     SDL_Event event;
 
+    if (unsent)
+    {
+        unsent = !events.Push(unsentEvent);
+    }
+
+    // One pass over everything pending: each transition updates its
+    // device's keypad mask through the lookup table and queues the
+    // combined state.
     while (SDL_PollEvent(&event))
     {
         switch(event.type) {
             case SDL_EVENT_QUIT:{
                 quit = true;
             } break;
-            case SDL_EVENT_KEY_DOWN: {
-                 
-                    switch (event.key.key) {
-                        case SDLK_ESCAPE: quit = true; break;
-                        case SDLK_X:      keys[0] = 1; break;
-                        case SDLK_1:      keys[1] = 1; break;
-                        case SDLK_2:      keys[2] = 1; break;
-                        case SDLK_3:      keys[3] = 1; break;
-                        case SDLK_Q:      keys[4] = 1; break;
-                        case SDLK_W:      keys[5] = 1; break;
-                        case SDLK_E:      keys[6] = 1; break;
-                        case SDLK_A:      keys[7] = 1; break;
-                        case SDLK_S:      keys[8] = 1; break;
-                        case SDLK_D:      keys[9] = 1; break;
-                        case SDLK_Z:      keys[0xA] = 1; break;
-                        case SDLK_C:      keys[0xB] = 1; break;
-                        case SDLK_4:      keys[0xC] = 1; break;
-                        case SDLK_R:      keys[0xD] = 1; break;
-                        case SDLK_F:      keys[0xE] = 1; break;
-                        case SDLK_V:      keys[0xF] = 1; break;
-                    }
-                } break;
+            case SDL_EVENT_KEY_DOWN:
             case SDL_EVENT_KEY_UP: {
-                    switch (event.key.key) {
-                        case SDLK_X:      keys[0] = 0; break;
-                        case SDLK_1:      keys[1] = 0; break;
-                        case SDLK_2:      keys[2] = 0; break;
-                        case SDLK_3:      keys[3] = 0; break;
-                        case SDLK_Q:      keys[4] = 0; break;
-                        case SDLK_W:      keys[5] = 0; break;
-                        case SDLK_E:      keys[6] = 0; break;
-                        case SDLK_A:      keys[7] = 0; break;
-                        case SDLK_S:      keys[8] = 0; break;
-                        case SDLK_D:      keys[9] = 0; break;
-                        case SDLK_Z:      keys[0xA] = 0; break;
-                        case SDLK_C:      keys[0xB] = 0; break;
-                        case SDLK_4:      keys[0xC] = 0; break;
-                        case SDLK_R:      keys[0xD] = 0; break;
-                        case SDLK_F:      keys[0xE] = 0; break;
-                        case SDLK_V:      keys[0xF] = 0; break;
+                    if (event.key.scancode == SDL_SCANCODE_ESCAPE)
+                    {
+                        quit = true;
+                        break;
+                    }
+                    if (!event.key.repeat)
+                    {
+                        SetKey(keyboardMask, keymap.Lookup(event.key.scancode),
+                            event.key.down, event.key.timestamp, false, events);
                     }
                 } break;
+            case SDL_EVENT_GAMEPAD_BUTTON_DOWN:
+            case SDL_EVENT_GAMEPAD_BUTTON_UP: {
+                    SetKey(gamepadMasks[event.gbutton.which], keymap.LookupButton(event.gbutton.button),
+                        event.gbutton.down, event.gbutton.timestamp, true, events);
+                } break;
+            case SDL_EVENT_GAMEPAD_ADDED: {
+                    SDL_OpenGamepad(event.gdevice.which);
+                } break;
+            case SDL_EVENT_GAMEPAD_REMOVED: {
+                    SDL_CloseGamepad(SDL_GetGamepadFromID(event.gdevice.which));
+                    gamepadMasks.erase(event.gdevice.which);
+                    QueueState(event.gdevice.timestamp, true, events);
+                } break;
         }
     }
     return quit;
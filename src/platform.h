@@ -1,17 +1,68 @@
 #include <SDL3/SDL.h>
 #pragma once
 
+#include <unordered_map>
+
+#include "keymap.h"
+#include "spsc_queue.h"
+
+// Keypad state after a transition (bit n = key n held), timestamped by SDL
+// (nanoseconds, SDL_GetTicksNS clock)
+struct KeyEvent
+{
+    Uint64 timestamp;
+    uint16_t keys;
+    bool gamepad; // transition came from a gamepad rather than the keyboard
+};
+
+using InputQueue = SPSCQueue<KeyEvent, 256>;
+
 class Platform
 {
     public:
         Platform(char const* title, int windowWidth, int windowHeight, 
         int textureWidth, int textureHeight);
         ~Platform();
+        // Starts timing a frame upload, so both paths below count the
+        // frame expansion as well as the texture update
+        void BeginUpload();
         void update(void const* buffer, int pitch);
-        bool ProcessInput(uint8_t* keys);
+        // Drains pending SDL events into the queue, returns true on quit
+        bool ProcessInput(InputQueue& events);
+        void SetKeyMap(KeyMap const& map);
+
+        // Direct upload path: write pixels straight into the locked
+        // streaming texture instead of having SDL copy a staging buffer.
+        uint32_t* Lock(int* pitch);
+        void Unlock();
+        void Present();
+
+        // Replace the texture with one of a new size (display mode change)
+        void Resize(int textureWidth, int textureHeight);
 
     private:
         SDL_Window* window{};
         SDL_Renderer* renderer{};
         SDL_Texture* texture{}; 
-};
\ No newline at end of file
+
+        void SetKey(uint16_t& mask, int8_t key, bool down, Uint64 timestamp,
+            bool gamepad, InputQueue& events);
+        void QueueState(Uint64 timestamp, bool gamepad, InputQueue& events);
+
+        KeyMap keymap;
+        // Held keys per device; the keypad sees them or'ed together, so a
+        // key stays down while any pad holds it
+        uint16_t keyboardMask{};
+        std::unordered_map<SDL_JoystickID, uint16_t> gamepadMasks;
+
+        // A state the full queue refused is kept and sent first next time,
+        // merged with any later transitions, so a release is never lost
+        bool unsent{};
+        KeyEvent unsentEvent{};
+        Uint64 mergedEvents{};
+
+        // Upload timing (expansion and texture update, present/vsync excluded)
+        Uint64 uploadStart{};
+        Uint64 copyTicks{}, copyFrames{};
+        Uint64 lockTicks{}, lockFrames{};
+};
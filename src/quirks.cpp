@@ -0,0 +1,35 @@
+#include "quirks.h"
+#include <cstring>
+
+
+static const char* const profileNames[] = { "vip", "chip48", "schip", "xochip" };
+
+bool ParseQuirkProfile(const char* name, QuirkProfile& profile)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        if (std::strcmp(name, profileNames[i]) == 0)
+        {
+            profile = static_cast<QuirkProfile>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* QuirkProfileName(QuirkProfile profile)
+{
+    return profileNames[static_cast<int>(profile)];
+}
+
+uint16_t QuirkAddressMask(QuirkProfile profile)
+{
+    switch (profile)
+    {
+        case QuirkProfile::CosmacVIP: return QuirksCosmacVIP::addressMask;
+        case QuirkProfile::Chip48:    return QuirksChip48::addressMask;
+        case QuirkProfile::SuperChip: return QuirksSuperChip::addressMask;
+        case QuirkProfile::XOChip:    return QuirksXOChip::addressMask;
+    }
+    return 0xFFFF;
+}
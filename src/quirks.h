@@ -0,0 +1,71 @@
+// quirks.h
+#pragma once
+
+#include <cstdint>
+
+// Behaviour that differs between CHIP-8 variants. Each profile is a set of
+// compile-time constants; CHIP8 instantiates the affected opcodes once per
+// profile, so the interpreter never tests a quirk at run time.
+
+enum class QuirkProfile
+{
+    CosmacVIP,
+    Chip48,
+    SuperChip,
+    XOChip
+};
+
+// How Fx55/Fx65 leave I afterwards
+enum class IndexQuirk
+{
+    Unchanged,  // SUPER-CHIP 1.1
+    AddX,       // CHIP-48
+    AddXPlus1   // COSMAC VIP, XO-CHIP
+};
+
+struct QuirksCosmacVIP
+{
+    static constexpr bool shiftUsesVy = true;       // 8xy6/8xyE shift Vy into Vx
+    static constexpr IndexQuirk loadStoreIndex = IndexQuirk::AddXPlus1;
+    static constexpr bool jumpUsesVx = false;       // Bnnn jumps to nnn + V0
+    static constexpr bool clipSprites = true;       // Dxyn clips at the edges
+    static constexpr bool logicResetsVF = true;     // 8xy1/8xy2/8xy3 clear VF
+    static constexpr uint16_t addressMask = 0x0FFF; // 4 KB, addresses wrap
+};
+
+struct QuirksChip48
+{
+    static constexpr bool shiftUsesVy = false;
+    static constexpr IndexQuirk loadStoreIndex = IndexQuirk::AddX;
+    static constexpr bool jumpUsesVx = true;        // Bxnn jumps to xnn + Vx
+    static constexpr bool clipSprites = true;
+    static constexpr bool logicResetsVF = false;
+    static constexpr uint16_t addressMask = 0x0FFF;
+};
+
+struct QuirksSuperChip
+{
+    static constexpr bool shiftUsesVy = false;
+    static constexpr IndexQuirk loadStoreIndex = IndexQuirk::Unchanged;
+    static constexpr bool jumpUsesVx = true;
+    static constexpr bool clipSprites = true;
+    static constexpr bool logicResetsVF = false;
+    static constexpr uint16_t addressMask = 0x0FFF;
+};
+
+struct QuirksXOChip
+{
+    static constexpr bool shiftUsesVy = true;
+    static constexpr IndexQuirk loadStoreIndex = IndexQuirk::AddXPlus1;
+    static constexpr bool jumpUsesVx = false;
+    static constexpr bool clipSprites = false;      // sprites wrap around
+    static constexpr bool logicResetsVF = false;
+    static constexpr uint16_t addressMask = 0xFFFF; // 64 KB
+};
+
+// "vip", "chip48", "schip", "xochip"; returns false for an unknown name
+bool ParseQuirkProfile(const char* name, QuirkProfile& profile);
+const char* QuirkProfileName(QuirkProfile profile);
+
+// The profile's addressMask, for code holding a profile rather than its type
+uint16_t QuirkAddressMask(QuirkProfile profile);
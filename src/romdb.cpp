@@ -0,0 +1,137 @@
+#include "romdb.h"
+#include "quirks.h"
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+RomDatabase::~RomDatabase()
+{
+    Close();
+}
+
+bool RomDatabase::Open(const char* filename)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    file = fileHandle;
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(fileHandle, &fileSize);
+    viewSize = (size_t)fileSize.QuadPart;
+
+    mapping = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        viewSize = (size_t)info.st_size;
+        view = mmap(nullptr, viewSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED)
+        {
+            view = nullptr;
+        }
+    }
+    close(fd); // the mapping keeps the file alive
+#endif
+
+    if (!view)
+    {
+        Close();
+        return false;
+    }
+
+    RomDbHeader const* header = static_cast<RomDbHeader const*>(view);
+
+    if (viewSize < sizeof(RomDbHeader) || std::memcmp(header->magic, "C8DB", 4) != 0
+        || header->version != VERSION
+        || viewSize < sizeof(RomDbHeader) + (size_t)header->count * sizeof(RomInfo))
+    {
+        std::cerr << "Error: " << filename << " is not a valid ROM database\n";
+        Close();
+        return false;
+    }
+
+    count = header->count;
+    records = reinterpret_cast<RomInfo const*>(header + 1);
+    return true;
+}
+
+void RomDatabase::Close()
+{
+#ifdef _WIN32
+    if (view) UnmapViewOfFile(view);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (view) munmap(view, viewSize);
+#endif
+    view = nullptr;
+    viewSize = 0;
+    records = nullptr;
+    count = 0;
+}
+
+RomInfo const* RomDatabase::Find(uint64_t hash) const
+{
+    uint32_t low = 0, high = count;
+
+    while (low < high)
+    {
+        uint32_t mid = low + (high - low) / 2;
+
+        if (records[mid].hash < hash)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return (low < count && records[low].hash == hash && Valid(records[low])) ? &records[low] : nullptr;
+}
+
+// The file is used as it is on disk, so a record is checked before anyone
+// casts its profile or reads its strings
+bool RomDatabase::Valid(RomInfo const& info)
+{
+    return info.profile <= static_cast<uint8_t>(QuirkProfile::XOChip)
+        && std::memchr(info.title, '\0', sizeof(info.title))
+        && std::memchr(info.layout, '\0', sizeof(info.layout));
+}
+
+uint64_t RomDatabase::Hash(uint8_t const* data, size_t size, uint64_t hash)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
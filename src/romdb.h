@@ -0,0 +1,59 @@
+// romdb.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// One fixed-size record of the ROM database file. The file is a RomDbHeader
+// followed by records sorted by hash and is used in place through a memory
+// mapping, so opening it costs nothing beyond the page faults of a lookup.
+struct RomInfo
+{
+    uint64_t hash;              // RomDatabase::Hash of the ROM image
+    uint16_t cyclesPerFrame;    // cheapest speed the ROM runs correctly at
+    uint8_t profile;            // QuirkProfile
+    uint8_t reserved[5];
+    char title[48];
+    char layout[16];            // keymap.cfg section, empty for default
+};
+
+struct RomDbHeader
+{
+    char magic[4];              // "C8DB"
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+class RomDatabase
+{
+    public:
+        static constexpr uint32_t VERSION = 1;
+
+        RomDatabase() = default;
+        ~RomDatabase();
+        RomDatabase(RomDatabase const&) = delete;
+        RomDatabase& operator=(RomDatabase const&) = delete;
+
+        bool Open(const char* filename);
+        void Close();
+
+        // Binary search over the mapped records, nullptr if unknown or if
+        // the record is corrupt (profile out of range, unterminated strings)
+        RomInfo const* Find(uint64_t hash) const;
+
+        // FNV-1a 64; pass a previous result as hash to continue it
+        static uint64_t Hash(uint8_t const* data, size_t size, uint64_t hash = 0xCBF29CE484222325ull);
+
+    private:
+        static bool Valid(RomInfo const& info);
+
+        void* view{};
+        size_t viewSize{};
+        RomInfo const* records{};
+        uint32_t count{};
+#ifdef _WIN32
+        void* file{};
+        void* mapping{};
+#endif
+};
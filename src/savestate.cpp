@@ -0,0 +1,199 @@
+#include "chip8.h"
+
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+
+// minstd_rand's whole state is one number below its modulus; its text form
+// is the only standard access to it
+static uint32_t RandomState(std::minstd_rand const& engine)
+{
+    std::ostringstream text;
+    text << engine;
+    return (uint32_t)std::stoul(text.str());
+}
+
+static bool SetRandomState(std::minstd_rand& engine, uint32_t state)
+{
+    // Zero would repeat forever
+    if (state == 0 || state >= std::minstd_rand::modulus)
+    {
+        return false;
+    }
+    std::istringstream text(std::to_string(state));
+    text >> engine;
+    return !text.fail();
+}
+
+namespace
+{
+    // Counts, writes or reads the fields in TransferState's order.
+    // Integers are stored little-endian whatever the host.
+    struct StateSizer
+    {
+        template <typename T> void Value(T&) { size += sizeof(T); }
+        void Bytes(void*, size_t length) { size += length; }
+
+        size_t size{};
+    };
+
+    struct StateWriter
+    {
+        template <typename T> void Value(T& value)
+        {
+            for (size_t i = 0; i < sizeof(T); ++i)
+            {
+                out[position++] = (uint8_t)((uint64_t)value >> (8 * i));
+            }
+        }
+
+        void Bytes(void* data, size_t length)
+        {
+            std::memcpy(out + position, data, length);
+            position += length;
+        }
+
+        uint8_t* out;
+        size_t position{};
+    };
+
+    struct StateReader
+    {
+        template <typename T> void Value(T& value)
+        {
+            uint64_t result = 0;
+            for (size_t i = 0; i < sizeof(T); ++i)
+            {
+                result |= (uint64_t)data[position++] << (8 * i);
+            }
+            value = (T)result;
+        }
+
+        void Bytes(void* out, size_t length)
+        {
+            std::memcpy(out, data + position, length);
+            position += length;
+        }
+
+        uint8_t const* data;
+        size_t position{};
+    };
+}
+
+// One list of fields for all three archives, so sizes and order can't drift
+template <typename Archive>
+void CHIP8::TransferState(Archive& archive)
+{
+    archive.Bytes(memory, sizeof(memory));
+    archive.Bytes(V, sizeof(V));
+    archive.Value(index);
+    archive.Value(Pc);
+    for (uint16_t& entry : stack)
+    {
+        archive.Value(entry);
+    }
+    archive.Value(sp);
+    archive.Value(delayTimer);
+    archive.Value(soundTimer);
+    archive.Bytes(pattern, sizeof(pattern));
+    archive.Value(pitch);
+    archive.Bytes(keypad, sizeof(keypad));
+    archive.Value(keyReads);
+    archive.Bytes(flags, sizeof(flags));
+    for (auto& plane : video)
+    {
+        for (auto& row : plane)
+        {
+            archive.Value(row[0]);
+            archive.Value(row[1]);
+        }
+    }
+    archive.Value(hires);
+    archive.Value(planeMask);
+    archive.Value(drawFlag);
+    archive.Value(opcode);
+    archive.Value(timingCarry);
+    archive.Value(romHash);
+}
+
+// Header: "C8ST", version, quirk profile, then the random generator
+static constexpr size_t HEADER_SIZE = 4 + 4 + 1 + 4;
+
+size_t CHIP8::StateSize()
+{
+    static size_t const size = [] {
+        // The sizer only looks at field types, any machine will do
+        std::unique_ptr<CHIP8> chip8(new CHIP8);
+        StateSizer sizer;
+        chip8->TransferState(sizer);
+        return HEADER_SIZE + sizer.size;
+    }();
+    return size;
+}
+
+bool CHIP8::SaveState(uint8_t* out, size_t size) const
+{
+    if (size < StateSize())
+    {
+        return false;
+    }
+
+    StateWriter writer{out};
+    uint32_t version = STATE_VERSION;
+    uint8_t profile = static_cast<uint8_t>(quirks);
+    uint32_t random = RandomState(randGen);
+
+    writer.Bytes(const_cast<char*>("C8ST"), 4);
+    writer.Value(version);
+    writer.Value(profile);
+    writer.Value(random);
+
+    // The writer only reads the fields
+    const_cast<CHIP8*>(this)->TransferState(writer);
+    return true;
+}
+
+bool CHIP8::LoadState(uint8_t const* data, size_t size)
+{
+    if (size < StateSize() || std::memcmp(data, "C8ST", 4) != 0)
+    {
+        return false;
+    }
+
+    StateReader reader{data, 4};
+    uint32_t version;
+    uint8_t profile;
+    uint32_t random;
+
+    reader.Value(version);
+    reader.Value(profile);
+    reader.Value(random);
+
+    if (version != STATE_VERSION || profile > static_cast<uint8_t>(QuirkProfile::XOChip))
+    {
+        return false;
+    }
+
+    // Read into a copy and commit only a state the core can run from: sp
+    // indexes the stack before 2nnn masks it, planeMask selects planes and
+    // Pc has to be inside the profile's memory
+    std::unique_ptr<CHIP8> loaded(new CHIP8(*this));
+    loaded->TransferState(reader);
+
+    if (!SetRandomState(loaded->randGen, random) || loaded->sp > 15 || loaded->planeMask > 3
+        || loaded->Pc > QuirkAddressMask(static_cast<QuirkProfile>(profile)))
+    {
+        return false;
+    }
+
+    uint64_t oldHash = romHash;
+    *this = *loaded;
+
+    SetQuirks(static_cast<QuirkProfile>(profile));
+    if (romHash != oldHash)
+    {
+        romInfo = nullptr;
+    }
+    return true;
+}
@@ -0,0 +1,89 @@
+// spsc_queue.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity must be a power of two; Push fails rather than blocks
+// when the queue is full.
+template <typename T, size_t Capacity>
+class SPSCQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    public:
+        bool Push(T const& item)
+        {
+            size_t head = writeIndex.load(std::memory_order_relaxed);
+
+            if (head - readIndex.load(std::memory_order_acquire) == Capacity)
+            {
+                return false;
+            }
+            items[head & (Capacity - 1)] = item;
+            writeIndex.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool Pop(T& item)
+        {
+            size_t tail = readIndex.load(std::memory_order_relaxed);
+
+            if (tail == writeIndex.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            item = items[tail & (Capacity - 1)];
+            readIndex.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Free slots, exact for the producer: the consumer only adds more
+        size_t Space() const
+        {
+            return Capacity - (writeIndex.load(std::memory_order_relaxed) - readIndex.load(std::memory_order_acquire));
+        }
+
+        // Bulk variants move as many items as fit/are available and return
+        // the count, publishing them with a single index update.
+        size_t Push(T const* src, size_t count)
+        {
+            size_t head = writeIndex.load(std::memory_order_relaxed);
+            size_t space = Capacity - (head - readIndex.load(std::memory_order_acquire));
+
+            if (count > space)
+            {
+                count = space;
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                items[(head + i) & (Capacity - 1)] = src[i];
+            }
+            writeIndex.store(head + count, std::memory_order_release);
+            return count;
+        }
+
+        size_t Pop(T* dst, size_t count)
+        {
+            size_t tail = readIndex.load(std::memory_order_relaxed);
+            size_t available = writeIndex.load(std::memory_order_acquire) - tail;
+
+            if (count > available)
+            {
+                count = available;
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                dst[i] = items[(tail + i) & (Capacity - 1)];
+            }
+            readIndex.store(tail + count, std::memory_order_release);
+            return count;
+        }
+
+    private:
+        T items[Capacity]{};
+        // Kept on separate cache lines so the two threads do not false-share
+        alignas(64) std::atomic<size_t> writeIndex{0};
+        alignas(64) std::atomic<size_t> readIndex{0};
+};
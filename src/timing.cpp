@@ -0,0 +1,45 @@
+#include "timing.h"
+#include "chip8.h"
+
+
+unsigned int VipTiming::Cost(CHIP8 const& chip8, uint16_t opcode)
+{
+    uint8_t x = (opcode & 0x0F00u) >> 8u;
+    uint8_t kk = opcode & 0x00FFu;
+
+    switch (opcode >> 12u)
+    {
+        case 0x0:
+            if (opcode == 0x00E0) return 24 + 64; // clears 256 bytes, 4 per loop
+            return 23;                            // 00EE, machine code calls
+        case 0x1: return 23;
+        case 0x2: return 23;
+        case 0x3: return chip8.V[x] == kk ? 14 : 12;
+        case 0x4: return chip8.V[x] != kk ? 14 : 12;
+        case 0x5: return 16;
+        case 0x6: return 6;
+        case 0x7: return 10;
+        case 0x8: return 44;
+        case 0x9: return 16;
+        case 0xA: return 12;
+        case 0xB: return 23;
+        case 0xC: return 36;
+        case 0xD: return DISPLAY_WAIT;
+        case 0xE: return 16;
+    }
+
+    switch (kk)
+    {
+        case 0x1E: return 19;
+        case 0x29: return 20;
+        case 0x33:
+        {
+            // BCD by repeated subtraction: every unit of every digit loops
+            uint8_t value = chip8.V[x];
+            return 84 + 4 * (value / 100 + (value / 10) % 10 + value % 10);
+        }
+        case 0x55:
+        case 0x65: return 14 + 8 * (x + 1u);
+        default:   return 10; // Fx07, Fx0A (per poll), Fx15, Fx18
+    }
+}
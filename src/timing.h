@@ -0,0 +1,34 @@
+// timing.h
+#pragma once
+
+#include <cstdint>
+
+class CHIP8;
+
+// Timing models for CHIP8::RunFrame. Cost() is charged before each
+// instruction executes; a frame ends once its budget is used up.
+
+// Every instruction costs 1, so the budget is simply instructions per frame
+struct FastTiming
+{
+    static constexpr bool waitsForDisplay = false;
+    static constexpr bool fuses = true;     // a superinstruction of n costs n
+
+    static unsigned int Cost(CHIP8 const&, uint16_t) { return 1; }
+};
+
+// COSMAC VIP interpreter cost in machine cycles (8 clocks of the 1.76 MHz
+// CDP1802), rounded from published measurements of the original
+// interpreter. Dxyn waits for the next display interrupt, ending the frame.
+struct VipTiming
+{
+    static constexpr bool waitsForDisplay = true;
+    static constexpr bool fuses = false;    // costs are per instruction
+
+    // 3668 machine cycles per 60 Hz frame, less the 1024 stolen by display
+    // DMA and the interrupt routine's 46
+    static constexpr unsigned int CYCLES_PER_FRAME = 3668 - 1024 - 46;
+    static constexpr unsigned int DISPLAY_WAIT = ~0u;
+
+    static unsigned int Cost(CHIP8 const& chip8, uint16_t opcode);
+};
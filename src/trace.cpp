@@ -0,0 +1,120 @@
+#include "trace.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+
+TraceRecorder::~TraceRecorder()
+{
+    Close();
+}
+
+bool TraceRecorder::Open(const char* filename, uint64_t romHash)
+{
+    Close();
+
+    file = std::fopen(filename, "wb");
+    if (!file)
+    {
+        std::cerr << "Error: Could not create trace " << filename << "\n";
+        return false;
+    }
+
+    TraceHeader header{};
+    std::memcpy(header.magic, "C8TR", 4);
+    header.version = VERSION;
+    header.romHash = romHash;
+    std::fwrite(&header, sizeof(header), 1, file);
+
+    // The emulation thread starts on one block, the rest wait in the pool
+    blocks = new Block[BLOCKS];
+    current = &blocks[0];
+    used = 0;
+    stalls = 0;
+    stallTime = {};
+    for (size_t i = 1; i < BLOCKS; ++i)
+    {
+        empty.Push(&blocks[i]);
+    }
+
+    stop.store(false);
+    writer = std::thread(&TraceRecorder::WriterLoop, this);
+    return true;
+}
+
+void TraceRecorder::Close()
+{
+    if (!file)
+    {
+        return;
+    }
+
+    if (used)
+    {
+        Submit();
+    }
+    stop.store(true, std::memory_order_release);
+    writer.join();
+
+    std::fclose(file);
+    file = nullptr;
+
+    delete[] blocks;
+    blocks = nullptr;
+    current = nullptr;
+
+    if (stalls)
+    {
+        std::cerr << "Trace: emulation waited on the disk " << stalls << " times, "
+            << std::chrono::duration<double, std::milli>(stallTime).count() << " ms in all\n";
+    }
+}
+
+void TraceRecorder::Submit()
+{
+    current->count = used;
+    used = 0;
+
+    // Always succeeds: there are only BLOCKS blocks
+    full.Push(current);
+
+    // Only waits when every block is queued for writing, i.e. the disk
+    // cannot keep up; a trace is useless with holes in it
+    if (empty.Pop(current))
+    {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ++stalls;
+    while (!empty.Pop(current))
+    {
+        std::this_thread::yield();
+    }
+    stallTime += std::chrono::steady_clock::now() - start;
+}
+
+void TraceRecorder::WriterLoop()
+{
+    for (;;)
+    {
+        // Read the flag first so blocks submitted before Close still drain
+        bool stopping = stop.load(std::memory_order_acquire);
+
+        Block* block;
+        if (full.Pop(block))
+        {
+            std::fwrite(block->records, sizeof(TraceRecord), block->count, file);
+            empty.Push(block);
+        }
+        else if (stopping)
+        {
+            break;
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    std::fflush(file);
+}
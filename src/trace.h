@@ -0,0 +1,92 @@
+// trace.h
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+#include "chip8.h"
+#include "spsc_queue.h"
+
+// One executed instruction, 8 bytes. Vx after the instruction is the
+// register nearly every opcode changes, VF catches the flag writes.
+struct TraceRecord
+{
+    uint16_t pc;
+    uint16_t opcode;
+    uint16_t index;     // I after the instruction
+    uint8_t vx;         // V[x] after the instruction
+    uint8_t vf;         // VF after the instruction
+};
+
+static_assert(sizeof(TraceRecord) == 8, "trace records are stored as-is");
+
+struct TraceHeader
+{
+    char magic[4];      // "C8TR"
+    uint32_t version;
+    uint64_t romHash;   // RomDatabase::Hash of the traced ROM
+};
+
+// Records instructions into fixed-size blocks owned by the emulation
+// thread. Full blocks go to a writer thread through a lock-free queue and
+// come back empty through another, so Record is a store and an increment.
+// The file is TraceHeader followed by the records in execution order.
+class TraceRecorder
+{
+    public:
+        static constexpr uint32_t VERSION = 1;
+        static constexpr size_t BLOCK_RECORDS = 1 << 16;   // 512 KB
+        static constexpr size_t BLOCKS = 8;
+
+        TraceRecorder() = default;
+        ~TraceRecorder();
+        TraceRecorder(TraceRecorder const&) = delete;
+        TraceRecorder& operator=(TraceRecorder const&) = delete;
+
+        bool Open(const char* filename, uint64_t romHash);
+        void Close();   // flushes everything recorded so far
+        bool IsOpen() const { return file != nullptr; }
+
+        // Call with the Pc and opcode fetched before chip8.Cycle(), after it
+        void Record(uint16_t pc, uint16_t opcode, CHIP8 const& chip8)
+        {
+            TraceRecord& record = current->records[used];
+            uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+            record.pc = pc;
+            record.opcode = opcode;
+            record.index = chip8.index;
+            record.vx = chip8.V[x];
+            record.vf = chip8.V[0xF];
+
+            if (++used == BLOCK_RECORDS)
+            {
+                Submit();
+            }
+        }
+
+    private:
+        struct Block
+        {
+            TraceRecord records[BLOCK_RECORDS];
+            size_t count;
+        };
+
+        void Submit();
+        void WriterLoop();
+
+        FILE* file{};
+        Block* blocks{};
+        Block* current{};
+        size_t used{};
+        uint64_t stalls{};                          // Submits that had to wait
+        std::chrono::steady_clock::duration stallTime{};
+
+        SPSCQueue<Block*, BLOCKS> full;
+        SPSCQueue<Block*, BLOCKS> empty;
+        std::atomic<bool> stop{false};
+        std::thread writer;
+};
@@ -0,0 +1,43 @@
+// triple_buffer.h
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Single-producer/single-consumer triple buffer. The producer always has a
+// private back buffer to write into and never waits; the consumer always
+// picks up the newest complete buffer and older unread ones are dropped.
+template <typename T>
+class TripleBuffer
+{
+    public:
+        // Producer side
+        T& Back() { return buffers[back]; }
+
+        void Publish()
+        {
+            back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+
+        // Consumer side, returns false if nothing new was published
+        bool Acquire()
+        {
+            if (!(middle.load(std::memory_order_relaxed) & FRESH))
+            {
+                return false;
+            }
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+            return true;
+        }
+
+        T const& Front() const { return buffers[front]; }
+
+    private:
+        static constexpr uint8_t INDEX_MASK = 0x3;
+        static constexpr uint8_t FRESH = 0x4;
+
+        T buffers[3]{};
+        uint8_t back{0};
+        uint8_t front{2};
+        std::atomic<uint8_t> middle{1};
+};
@@ -0,0 +1,564 @@
+// chip8-conform: runs ROMs through every execution engine in lockstep and
+// compares full state hashes, reporting the first divergence
+//
+//   chip8-conform [--instructions n] [--interval n] [--ipf n] [--vip-frames n]
+//                 [--movie file] [--jobs n] [ROM or directory...]
+//
+// Every ROM runs under each quirk profile. The VIP timing model is also
+// checked frame by frame against the same loop over the switch engine.
+// Without ROM arguments the roms/ folder is checked. A movie file holds
+// '<frame> <hex keypad mask>' lines; each mask is held until the next line.
+// Without one, a fixed pseudo-random movie presses a key or two every few
+// frames so Ex9E/ExA1/Fx0A paths get exercised. Each ROM's final state also
+// has to survive a save state round trip. A few hand-placed programs check
+// corners the ROMs don't reach.
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chip8.h"
+#include "movie.h"
+#include "timing.h"
+
+// step runs at least one and at most limit instructions and returns how
+// many; the fused and run engines may run more than one
+struct Engine
+{
+    char const* name;
+    unsigned int (*step)(CHIP8&, unsigned int limit);
+};
+
+// The first engine is the reference the others are compared against
+static const Engine engines[] = {
+    { "lut",      [](CHIP8& chip8, unsigned int) { chip8.Cycle(); return 1u; } },
+    { "handlers", [](CHIP8& chip8, unsigned int) { chip8.CycleHandlers(); return 1u; } },
+    { "tables",   [](CHIP8& chip8, unsigned int) { chip8.CycleTables(); return 1u; } },
+    { "switch",   [](CHIP8& chip8, unsigned int) { chip8.CycleSwitch(); return 1u; } },
+    { "fused",    [](CHIP8& chip8, unsigned int limit) { return chip8.CycleFused(limit); } },
+    { "run",      [](CHIP8& chip8, unsigned int limit) {
+        chip8.Run(limit, CHIP8::STOP_DRAW | CHIP8::STOP_KEY_WAIT | CHIP8::STOP_SOUND);
+        return chip8.runCycles;
+    } },
+};
+
+static constexpr size_t ENGINES = sizeof(engines) / sizeof(engines[0]);
+
+struct Options
+{
+    uint64_t instructions = 1000000;
+    uint64_t interval = 1000;
+    unsigned int cyclesPerFrame = 15;
+    uint64_t vipFrames = 3000;
+    std::vector<MovieEntry> movie;
+};
+
+// One engine's machine plus its position in the movie
+class Run
+{
+    public:
+        Run(Engine const& engine, std::vector<uint8_t> const& rom, QuirkProfile profile, Options const& options)
+            : engine(engine), options(options), chip8(new CHIP8)
+        {
+            chip8->loadROM(rom.data(), rom.size(), nullptr, profile);
+            chip8->randGen.seed(1);
+        }
+
+        Run(Run const& other)
+            : engine(other.engine), options(other.options), chip8(new CHIP8(*other.chip8)),
+              frame(other.frame), cycle(other.cycle), next(other.next)
+        {
+        }
+
+        // Runs up to limit instructions, never past the end of the frame
+        unsigned int Step(unsigned int limit)
+        {
+            if (cycle == 0)
+            {
+                next = ApplyMovie(options.movie, next, frame, chip8->keypad);
+            }
+
+            unsigned int count = engine.step(*chip8, std::min(limit, options.cyclesPerFrame - cycle));
+
+            cycle += count;
+            if (cycle == options.cyclesPerFrame)
+            {
+                cycle = 0;
+                ++frame;
+                chip8->UpdateTimers();
+            }
+            return count;
+        }
+
+        Engine const& engine;
+        Options const& options;
+        std::unique_ptr<CHIP8> chip8;   // 64 KB of memory, keep it off the stack
+        uint64_t frame{};
+        unsigned int cycle{};
+        size_t next{};
+};
+
+static void DumpState(std::ostringstream& out, char const* name, CHIP8 const& chip8)
+{
+    char line[160];
+    std::snprintf(line, sizeof(line), "  %-8s PC %04X I %04X SP %X DT %02X ST %02X hires %d planes %X hash %016llx\n",
+        name, chip8.Pc, chip8.index, chip8.sp, chip8.delayTimer, chip8.soundTimer,
+        chip8.hires, chip8.planeMask, (unsigned long long)chip8.StateHash());
+    out << line << "          ";
+
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        std::snprintf(line, sizeof(line), "V%X %02X ", i, chip8.V[i]);
+        out << line;
+    }
+    out << "\n          stack";
+    for (unsigned int i = 0; i < chip8.sp && i < 16; ++i)
+    {
+        std::snprintf(line, sizeof(line), " %04X", chip8.stack[i]);
+        out << line;
+    }
+    out << "\n";
+}
+
+// Lists where two machines differ beyond the registers dumped above
+static void DumpDifferences(std::ostringstream& out, CHIP8 const& a, CHIP8 const& b)
+{
+    char line[80];
+    unsigned int shown = 0;
+
+    for (size_t i = 0; i < sizeof(a.memory) && shown < 16; ++i)
+    {
+        if (a.memory[i] != b.memory[i])
+        {
+            std::snprintf(line, sizeof(line), "  memory[%04zX] %02X vs %02X\n", i, a.memory[i], b.memory[i]);
+            out << line;
+            ++shown;
+        }
+    }
+
+    for (unsigned int p = 0; p < CHIP8::PLANES; ++p)
+    {
+        for (unsigned int y = 0; y < CHIP8::HIRES_HEIGHT; ++y)
+        {
+            if (std::memcmp(a.video[p][y], b.video[p][y], sizeof(a.video[p][y])) != 0)
+            {
+                std::snprintf(line, sizeof(line), "  plane %u row %u differs\n", p, y);
+                out << line;
+            }
+        }
+    }
+}
+
+// Saves the machine, loads it into a fresh one and checks the two agree,
+// including the random numbers still to come
+static bool CheckSaveState(CHIP8 const& chip8)
+{
+    std::vector<uint8_t> state(CHIP8::StateSize()), again(CHIP8::StateSize());
+    std::unique_ptr<CHIP8> loaded(new CHIP8);
+    std::unique_ptr<CHIP8> original(new CHIP8(chip8));
+
+    if (!original->SaveState(state.data(), state.size()) || !loaded->LoadState(state.data(), state.size())
+        || !loaded->SaveState(again.data(), again.size()) || state != again
+        || loaded->StateHash() != original->StateHash() || loaded->quirks != original->quirks)
+    {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        if (loaded->randGen() != original->randGen())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs a hand-placed program through every engine from the same start and
+// compares the states after the given number of instructions, where the
+// program should have parked at expectedPc
+static bool CheckProgram(char const* name, CHIP8 const& start, uint64_t instructions, uint16_t expectedPc)
+{
+    std::unique_ptr<CHIP8> reference(new CHIP8(start));
+    for (uint64_t i = 0; i < instructions; ++i)
+    {
+        engines[0].step(*reference, 1);
+    }
+
+    if (reference->Pc != expectedPc)
+    {
+        std::printf("FAIL  %s: %s ends at %04X, expected %04X\n", name, engines[0].name, reference->Pc, expectedPc);
+        return false;
+    }
+
+    for (size_t e = 1; e < ENGINES; ++e)
+    {
+        std::unique_ptr<CHIP8> chip8(new CHIP8(start));
+        for (uint64_t i = 0; i < instructions; )
+        {
+            i += engines[e].step(*chip8, (unsigned int)(instructions - i));
+        }
+
+        if (chip8->StateHash() != reference->StateHash())
+        {
+            std::ostringstream out;
+            out << "FAIL  " << name << ": " << engines[e].name << " diverges from " << engines[0].name << "\n";
+            DumpState(out, engines[0].name, *reference);
+            DumpState(out, engines[e].name, *chip8);
+            std::cout << out.str();
+            return false;
+        }
+    }
+    std::cout << "OK    " << name << "\n";
+    return true;
+}
+
+// Fx07 3x00 1nnn at 1234 is not a wait loop: 1234 jumps to 0234, which
+// only the 4 KB profiles would alias back to 1234
+static bool CheckHighWaitLoop()
+{
+    std::unique_ptr<CHIP8> chip8(new CHIP8);
+    chip8->SetQuirks(QuirkProfile::XOChip);
+
+    uint8_t const loop[] = { 0xF0, 0x07, 0x30, 0x00, 0x12, 0x34 };
+    std::copy(std::begin(loop), std::end(loop), &chip8->memory[0x1234]);
+    chip8->memory[0x234] = 0x12;    // 0234: jump to itself
+    chip8->memory[0x235] = 0x34;
+    chip8->Pc = 0x1234;
+    chip8->delayTimer = 5;
+
+    return CheckProgram("[xochip] timer wait at 1234", *chip8, 30, 0x234);
+}
+
+// On the 4 KB profiles the fetch wraps like data accesses do: code running
+// off 0FFF continues at 0000
+static bool CheckFetchWrap()
+{
+    std::unique_ptr<CHIP8> chip8(new CHIP8);
+    chip8->SetQuirks(QuirkProfile::CosmacVIP);
+
+    chip8->memory[0xFFE] = 0x61;    // 0FFE: V1 = 55
+    chip8->memory[0xFFF] = 0x55;
+    chip8->memory[0x000] = 0x10;    // 0000: jump to itself
+    chip8->memory[0x001] = 0x00;
+    chip8->Pc = 0xFFE;
+
+    return CheckProgram("[vip] fetch wraps at 0FFF", *chip8, 10, 0x000);
+}
+
+// RunFrame<VipTiming> written out over the reference engine
+static void ReferenceVipFrame(CHIP8& chip8)
+{
+    int remaining = (int)VipTiming::CYCLES_PER_FRAME + chip8.timingCarry;
+
+    while (remaining > 0)
+    {
+        uint16_t opcode = (chip8.memory[chip8.Pc] << 8u) | chip8.memory[(chip8.Pc + 1) & chip8.addressMask];
+        unsigned int cost = VipTiming::Cost(chip8, opcode);
+
+        chip8.CycleSwitch();
+        if (cost == VipTiming::DISPLAY_WAIT)
+        {
+            remaining = 0;
+            break;
+        }
+        remaining -= (int)cost;
+    }
+    chip8.timingCarry = remaining;
+    chip8.UpdateTimers();
+}
+
+// Compares the timed frame loop with the reference frame by frame; frames
+// is set to how many agreed
+static bool CheckVipTiming(std::vector<uint8_t> const& rom, QuirkProfile profile, Options const& options,
+    std::string const& name, uint64_t& frames, std::ostringstream& out)
+{
+    std::unique_ptr<CHIP8> timed(new CHIP8), reference(new CHIP8);
+    for (CHIP8* chip8 : { timed.get(), reference.get() })
+    {
+        chip8->loadROM(rom.data(), rom.size(), nullptr, profile);
+        chip8->randGen.seed(1);
+    }
+
+    size_t next = 0;
+    for (uint64_t frame = 0; frame < options.vipFrames; ++frame)
+    {
+        next = ApplyMovie(options.movie, next, frame, timed->keypad);
+        std::copy(std::begin(timed->keypad), std::end(timed->keypad), reference->keypad);
+
+        timed->RunFrame<VipTiming>(VipTiming::CYCLES_PER_FRAME);
+        ReferenceVipFrame(*reference);
+
+        if (timed->StateHash() != reference->StateHash() || timed->timingCarry != reference->timingCarry)
+        {
+            char line[160];
+            std::snprintf(line, sizeof(line), "FAIL  %s: vip timing diverges from the reference in frame %llu"
+                " (carry %d vs %d)\n", name.c_str(), (unsigned long long)frame,
+                timed->timingCarry, reference->timingCarry);
+            out << line;
+            DumpState(out, "timed", *timed);
+            DumpState(out, "switch", *reference);
+            DumpDifferences(out, *timed, *reference);
+            frames = frame;
+            return false;
+        }
+    }
+    frames = options.vipFrames;
+    return true;
+}
+
+static bool CheckProfile(std::filesystem::path const& path, std::vector<uint8_t> const& rom, QuirkProfile profile,
+    Options const& options, std::ostringstream& out)
+{
+    std::string name = path.string() + " [" + QuirkProfileName(profile) + "]";
+
+    // saved holds every engine at the last checkpoint where all agreed
+    std::vector<std::unique_ptr<Run>> runs, saved;
+    for (Engine const& engine : engines)
+    {
+        runs.emplace_back(new Run(engine, rom, profile, options));
+        saved.emplace_back(new Run(*runs.back()));
+    }
+
+    uint64_t checked = 0;
+    for (uint64_t done = 0; done < options.instructions; )
+    {
+        uint64_t batch = std::min(options.interval, options.instructions - done);
+        for (auto& run : runs)
+        {
+            for (uint64_t i = 0; i < batch; )
+            {
+                i += run->Step((unsigned int)(batch - i));
+            }
+        }
+        done += batch;
+
+        uint64_t reference = runs[0]->chip8->StateHash();
+        for (size_t e = 1; e < ENGINES; ++e)
+        {
+            if (runs[e]->chip8->StateHash() == reference)
+            {
+                continue;
+            }
+
+            // Replay both from the last good checkpoint one step of b at a
+            // time, the reference following instruction by instruction, to
+            // find the exact step the states part at
+            Run a(*saved[0]);
+            Run b(*saved[e]);
+            uint64_t instruction = done - batch, first = instruction;
+            uint16_t pc = 0, opcode = 0;
+            unsigned int count = 0;
+
+            while (a.chip8->StateHash() == b.chip8->StateHash() && instruction < done)
+            {
+                pc = a.chip8->Pc;
+                opcode = (a.chip8->memory[pc] << 8u) | a.chip8->memory[(pc + 1) & a.chip8->addressMask];
+                first = instruction;
+                count = b.Step((unsigned int)(done - instruction));
+                for (unsigned int i = 0; i < count; ++i)
+                {
+                    a.Step(1);
+                }
+                instruction += count;
+            }
+
+            char line[160];
+            std::snprintf(line, sizeof(line), "FAIL  %s: %s diverges from %s at instruction %llu (%04X: %s)%s\n",
+                name.c_str(), engines[e].name, engines[0].name,
+                (unsigned long long)first, pc, Disassemble(opcode).c_str(),
+                count > 1 ? " starting a superinstruction" : "");
+            out << line;
+            DumpState(out, engines[0].name, *a.chip8);
+            DumpState(out, engines[e].name, *b.chip8);
+            DumpDifferences(out, *a.chip8, *b.chip8);
+            return false;
+        }
+        for (size_t e = 0; e < ENGINES; ++e)
+        {
+            saved[e].reset(new Run(*runs[e]));
+        }
+        ++checked;
+    }
+
+    uint64_t vipFrames = options.vipFrames;
+    if (!CheckVipTiming(rom, profile, options, name, vipFrames, out))
+    {
+        return false;
+    }
+
+    if (!CheckSaveState(*runs[0]->chip8))
+    {
+        out << "FAIL  " << name << ": save state does not round-trip\n";
+        return false;
+    }
+
+    out << "OK    " << name << ": " << options.instructions << " instructions, "
+        << checked << " checkpoints, " << ENGINES << " engines, " << vipFrames << " vip timing frames\n";
+    return true;
+}
+
+// Every profile, so each one's specialised handlers get compared
+static bool CheckRom(std::filesystem::path const& path, Options const& options, std::ostringstream& out)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (!file.good() && !file.eof())
+    {
+        out << "ERROR " << path.string() << ": could not read\n";
+        return false;
+    }
+
+    bool ok = true;
+    for (QuirkProfile profile : { QuirkProfile::CosmacVIP, QuirkProfile::Chip48,
+                                  QuirkProfile::SuperChip, QuirkProfile::XOChip })
+    {
+        ok = CheckProfile(path, rom, profile, options, out) && ok;
+    }
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    unsigned int jobs = std::max(1u, std::thread::hardware_concurrency());
+    const char* movieFilename = nullptr;
+    std::vector<std::filesystem::path> inputs;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(argv[i], "--instructions") == 0 && hasValue)
+        {
+            options.instructions = std::stoull(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--interval") == 0 && hasValue)
+        {
+            options.interval = std::max(1ull, std::stoull(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--ipf") == 0 && hasValue)
+        {
+            options.cyclesPerFrame = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--vip-frames") == 0 && hasValue)
+        {
+            options.vipFrames = std::stoull(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--movie") == 0 && hasValue)
+        {
+            movieFilename = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--jobs") == 0 && hasValue)
+        {
+            jobs = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (argv[i][0] == '-')
+        {
+            std::cerr << "Usage: " << argv[0] << " [--instructions <n>] [--interval <n>] [--ipf <n>]"
+                " [--vip-frames <n>] [--movie <file>] [--jobs <n>] [ROM or directory...]\n";
+            return EXIT_FAILURE;
+        }
+        else
+        {
+            inputs.push_back(argv[i]);
+        }
+    }
+
+    // DECODE_LUT is built from only the outer nibbles of each opcode;
+    // check that really covers every opcode the same way Decode does
+    for (uint32_t opcode = 0; opcode <= 0xFFFF; ++opcode)
+    {
+        if (DECODE_LUT.ids[opcode] != Decode((uint16_t)opcode))
+        {
+            std::printf("FAIL  DECODE_LUT disagrees with Decode at %04X\n", opcode);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!CheckHighWaitLoop() || !CheckFetchWrap())
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (movieFilename)
+    {
+        if (!LoadMovie(movieFilename, options.movie))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        options.movie = DefaultMovie(std::max(options.instructions / options.cyclesPerFrame + 1, options.vipFrames));
+    }
+
+    if (inputs.empty())
+    {
+        inputs.push_back("roms");
+    }
+
+    std::vector<std::filesystem::path> roms;
+    for (auto const& input : inputs)
+    {
+        std::error_code error;
+        if (std::filesystem::is_directory(input, error))
+        {
+            for (auto const& entry : std::filesystem::directory_iterator(input, error))
+            {
+                if (entry.is_regular_file())
+                {
+                    roms.push_back(entry.path());
+                }
+            }
+        }
+        else
+        {
+            roms.push_back(input);
+        }
+    }
+    std::sort(roms.begin(), roms.end());
+
+    // ROMs are independent, so workers just take the next one; results are
+    // printed afterwards in ROM order
+    std::vector<std::ostringstream> results(roms.size());
+    std::atomic<size_t> nextRom{0};
+    std::atomic<unsigned int> failures{0};
+    std::vector<std::thread> workers;
+
+    for (unsigned int j = 0; j < std::min<size_t>(jobs, roms.size()); ++j)
+    {
+        workers.emplace_back([&]() {
+            for (size_t r; (r = nextRom.fetch_add(1)) < roms.size(); )
+            {
+                if (!CheckRom(roms[r], options, results[r]))
+                {
+                    failures.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    for (auto const& result : results)
+    {
+        std::cout << result.str();
+    }
+    std::cout << roms.size() - failures << "/" << roms.size() << " ROMs conform\n";
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,272 @@
+// chip8-debug: command console debugger, runs the ROM without a window
+//
+//   chip8-debug <ROM> [--ipf n] [--quirks vip|chip48|schip|xochip] [--romdb file]
+//
+// Type 'help' at the prompt for the command list. Numbers are hex.
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "chip8.h"
+#include "debugger.h"
+
+static constexpr int DEFAULT_CYCLES_PER_FRAME = 11;
+
+// Continue/step-over/step-out give up after this many instructions
+static constexpr uint64_t RUN_LIMIT = 100000000;
+
+static void PrintHelp()
+{
+    std::printf(
+        "  c                 continue until a breakpoint or watch fires\n"
+        "  s [n]             step n instructions\n"
+        "  n                 step over a 2nnn call\n"
+        "  o                 step out of the current subroutine\n"
+        "  b <addr>          set breakpoint       d <addr>   delete breakpoint\n"
+        "  w <addr> [len]    watch Fx55/Fx33 writes   uw <addr> [len]  unwatch\n"
+        "  rw <V0-VF|I>      watch a register     urw <reg>  unwatch\n"
+        "  clear             remove all breakpoints and watches\n"
+        "  r                 registers            m <addr> [len]  memory\n"
+        "  screen            print the display    q          quit\n");
+}
+
+static void PrintRegisters(CHIP8 const& chip8)
+{
+    std::printf("PC %04X  I %04X  SP %X  DT %02X  ST %02X  opcode %02X%02X\n",
+        chip8.Pc, chip8.index, chip8.sp, chip8.delayTimer, chip8.soundTimer,
+        chip8.memory[chip8.Pc], chip8.memory[(chip8.Pc + 1) & chip8.addressMask]);
+
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        std::printf("V%X %02X%s", i, chip8.V[i], (i % 8 == 7) ? "\n" : "  ");
+    }
+}
+
+static void PrintMemory(CHIP8 const& chip8, unsigned int address, unsigned int length)
+{
+    for (unsigned int i = 0; i < length; ++i)
+    {
+        if (i % 16 == 0)
+        {
+            std::printf("%s%04X:", i ? "\n" : "", (address + i) & 0xFFFFu);
+        }
+        std::printf(" %02X", chip8.memory[(address + i) & 0xFFFFu]);
+    }
+    std::printf("\n");
+}
+
+static void PrintScreen(CHIP8 const& chip8)
+{
+    for (unsigned int y = 0; y < chip8.Height(); ++y)
+    {
+        std::string row;
+        for (unsigned int x = 0; x < chip8.Width(); ++x)
+        {
+            unsigned int shift = 63 - (x & 63);
+            unsigned int colour = ((chip8.video[0][y][x >> 6] >> shift) & 1u)
+                | (((chip8.video[1][y][x >> 6] >> shift) & 1u) << 1);
+            row += " #+*"[colour];
+        }
+        std::printf("%s\n", row.c_str());
+    }
+}
+
+// "V0".."VF" -> bit 0-15, "I" -> WATCH_INDEX, 0 if not a register
+static uint32_t ParseRegister(std::string const& name)
+{
+    if (name == "I" || name == "i")
+    {
+        return Debugger::WATCH_INDEX;
+    }
+    if (name.size() == 2 && (name[0] == 'V' || name[0] == 'v') && std::isxdigit((unsigned char)name[1]))
+    {
+        return 1u << std::stoul(name.substr(1), nullptr, 16);
+    }
+    return 0;
+}
+
+static void Report(Debugger::StopReason reason, Debugger const& debugger, CHIP8 const& chip8)
+{
+    switch (reason)
+    {
+        case Debugger::StopReason::Breakpoint:
+            std::printf("Breakpoint at %04X\n", chip8.Pc);
+            break;
+        case Debugger::StopReason::Watchpoint:
+            std::printf("Write to watched %04X at %04X\n", debugger.WatchAddress(), chip8.Pc);
+            break;
+        case Debugger::StopReason::RegisterWatch:
+            std::printf("Watched register changed (mask %05X)\n", debugger.ChangedRegisters());
+            break;
+        case Debugger::StopReason::Limit:
+            std::printf("Stopped after %llu instructions\n", (unsigned long long)RUN_LIMIT);
+            break;
+        case Debugger::StopReason::Step:
+            break;
+    }
+    PrintRegisters(chip8);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc % 2 != 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " <ROM> [--ipf <cycles per frame>]"
+            " [--quirks vip|chip48|schip|xochip] [--romdb <file>]\n";
+        return EXIT_FAILURE;
+    }
+
+    char const* romdbFilename = "romdb.bin";
+    char const* quirkName = nullptr;
+    int cyclesPerFrame = 0;
+
+    for (int i = 2; i < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--ipf") == 0)
+        {
+            cyclesPerFrame = std::stoi(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--quirks") == 0)
+        {
+            quirkName = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--romdb") == 0)
+        {
+            romdbFilename = argv[i + 1];
+        }
+        else
+        {
+            std::cerr << "Error: Unknown option " << argv[i] << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    RomDatabase romdb;
+    romdb.Open(romdbFilename);
+
+    CHIP8 chip8;
+    if (!chip8.loadROM(argv[1], &romdb))
+    {
+        std::cerr << "Error: Could not load ROM " << argv[1] << "\n";
+        return EXIT_FAILURE;
+    }
+
+    if (quirkName)
+    {
+        QuirkProfile profile;
+        if (!ParseQuirkProfile(quirkName, profile))
+        {
+            std::cerr << "Error: Unknown quirk profile " << quirkName << "\n";
+            return EXIT_FAILURE;
+        }
+        chip8.SetQuirks(profile);
+    }
+
+    if (!cyclesPerFrame && chip8.romInfo)
+    {
+        cyclesPerFrame = chip8.romInfo->cyclesPerFrame;
+    }
+    if (cyclesPerFrame <= 0)
+    {
+        cyclesPerFrame = DEFAULT_CYCLES_PER_FRAME;
+    }
+
+    Debugger debugger(chip8, cyclesPerFrame);
+    PrintRegisters(chip8);
+
+    std::string line;
+    while (std::printf("> "), std::fflush(stdout), std::getline(std::cin, line))
+    {
+        std::istringstream args(line);
+        std::string command, first;
+        args >> command >> first;
+
+        unsigned long value = 0, length = 1;
+        bool hasValue = false;
+        try
+        {
+            if (!first.empty() && !ParseRegister(first))
+            {
+                value = std::stoul(first, nullptr, 16);
+                hasValue = true;
+            }
+            std::string second;
+            if (args >> second)
+            {
+                length = std::stoul(second, nullptr, 16);
+            }
+        }
+        catch (std::exception const&)
+        {
+            std::printf("Bad number\n");
+            continue;
+        }
+
+        if (command.empty())
+        {
+            continue;
+        }
+        else if (command == "q")
+        {
+            break;
+        }
+        else if (command == "help" || command == "h")
+        {
+            PrintHelp();
+        }
+        else if (command == "c")
+        {
+            Report(debugger.Continue(RUN_LIMIT), debugger, chip8);
+        }
+        else if (command == "s")
+        {
+            Report(debugger.Step(hasValue ? value : 1), debugger, chip8);
+        }
+        else if (command == "n")
+        {
+            Report(debugger.StepOver(RUN_LIMIT), debugger, chip8);
+        }
+        else if (command == "o")
+        {
+            Report(debugger.StepOut(RUN_LIMIT), debugger, chip8);
+        }
+        else if ((command == "b" || command == "d") && hasValue)
+        {
+            debugger.SetBreakpoint(value & 0xFFFFu, command == "b");
+        }
+        else if ((command == "w" || command == "uw") && hasValue)
+        {
+            debugger.SetWatchpoint(value & 0xFFFFu, length, command == "w");
+        }
+        else if ((command == "rw" || command == "urw") && ParseRegister(first))
+        {
+            debugger.WatchRegisters(ParseRegister(first), command == "rw");
+        }
+        else if (command == "clear")
+        {
+            debugger.ClearAll();
+        }
+        else if (command == "r")
+        {
+            PrintRegisters(chip8);
+        }
+        else if (command == "m" && hasValue)
+        {
+            PrintMemory(chip8, value, args ? length : 16);
+        }
+        else if (command == "screen")
+        {
+            PrintScreen(chip8);
+        }
+        else
+        {
+            std::printf("Unknown command, try 'help'\n");
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+// chip8-dis: disassembles a ROM along its recovered control flow
+//
+//   chip8-dis <ROM> [--dot | --json]
+//
+// The default listing labels block starts, marks idle loops and prints
+// bytes no path reaches as data. --dot and --json emit the graph instead.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include "cfg.h"
+#include "chip8.h"
+
+static void PrintListing(ControlFlowGraph const& cfg, uint8_t const* memory, size_t romEnd)
+{
+    size_t address = CHIP8::START_ADDRESS;
+
+    while (address < romEnd)
+    {
+        if (!cfg.IsInstruction(address))
+        {
+            // Up to 8 bytes of data per line, stopping at the next code
+            std::printf("%03zX  DB", address);
+            for (size_t i = 0; i < 8 && address < romEnd && !cfg.IsCode(address); ++i, ++address)
+            {
+                std::printf(" %02X", memory[address]);
+            }
+            std::printf("\n");
+            continue;
+        }
+
+        BasicBlock const* block = cfg.FindBlock(address);
+        if (block && block->start == address)
+        {
+            IdleLoop const* loop = cfg.FindIdleLoop(address);
+            std::printf("\nL%03zX:%s\n", address, (loop && loop->start == address) ? "    ; idle loop" : "");
+        }
+
+        uint16_t opcode = (memory[address] << 8u) | memory[address + 1];
+        uint16_t next = (memory[address + 2] << 8u) | memory[address + 3];
+        unsigned int length = InstructionLength(Decode(opcode));
+
+        std::printf("%03zX  %04X%s  %s\n", address, opcode,
+            length == 4 ? "" : "    ", Disassemble(opcode, next).c_str());
+
+        address += length;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bool dot = argc == 3 && std::strcmp(argv[2], "--dot") == 0;
+    bool json = argc == 3 && std::strcmp(argv[2], "--json") == 0;
+
+    if (argc != 2 && !dot && !json)
+    {
+        std::cerr << "Usage: " << argv[0] << " <ROM> [--dot | --json]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Error: Could not open " << argv[1] << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (rom.size() > 65536 - CHIP8::START_ADDRESS)
+    {
+        std::cerr << "Error: ROM too large\n";
+        return EXIT_FAILURE;
+    }
+
+    // Laid out as the core loads it; the padding keeps 4-byte reads in range
+    std::vector<uint8_t> memory(65536 + 4);
+    std::copy(rom.begin(), rom.end(), memory.begin() + CHIP8::START_ADDRESS);
+    size_t romEnd = CHIP8::START_ADDRESS + rom.size();
+
+    ControlFlowGraph cfg;
+    cfg.Build(memory.data(), romEnd);
+
+    if (dot)
+    {
+        cfg.WriteDot(std::cout);
+    }
+    else if (json)
+    {
+        cfg.WriteJson(std::cout);
+    }
+    else
+    {
+        PrintListing(cfg, memory.data(), romEnd);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+// chip8-fuzz: fuzz target for the interpreter core
+//
+// With libFuzzer (clang++ -fsanitize=fuzzer,address -DCHIP8_LIBFUZZER) the
+// engine drives LLVMFuzzerTestOneInput directly. Without it the file builds
+// a driver for AFL and for replaying crashes:
+//
+//   chip8-fuzz <input>...      run each input file once
+//   chip8-fuzz                 run one input from stdin (AFL)
+//   chip8-fuzz --random <n>    run n random inputs, for a quick smoke test
+//
+// Input layout: byte 0 picks the quirk profile (bits 0-1), the engine
+// (bits 2-4, see RunFrame below) and Run's stop events (bits 5-7); bytes
+// 1-2 are the keypad mask, rotated every frame; the rest is the ROM image
+// loaded at 0x200.
+#include <bitset>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "chip8.h"
+#include "timing.h"
+
+// Per input: enough for loops, calls and a few timer ticks, small enough
+// for tens of thousands of execs per second per core
+static constexpr unsigned int INSTRUCTIONS = 20000;
+static constexpr unsigned int CYCLES_PER_FRAME = 20;
+static constexpr unsigned int FRAMES = INSTRUCTIONS / CYCLES_PER_FRAME;
+
+static CHIP8& Machine()
+{
+    // Built once: fonts and dispatch tables; every input starts from a copy
+    // of it rather than re-running the constructor
+    static std::unique_ptr<CHIP8> pristine(new CHIP8);
+    static std::unique_ptr<CHIP8> machine(new CHIP8);
+
+    *machine = *pristine;
+    return *machine;
+}
+
+// The entry point, which most main loops jump back to
+static std::bitset<65536> const& EntryBreakpoint()
+{
+    static std::bitset<65536> const breakpoints = std::bitset<65536>().set(CHIP8::START_ADDRESS);
+    return breakpoints;
+}
+
+// One frame on the engine chosen by the input, timers included; returns
+// the instructions executed
+static unsigned int RunFrame(CHIP8& chip8, unsigned int engine, uint32_t stopMask)
+{
+    unsigned int executed = 0;
+
+    switch (engine)
+    {
+        case 0:
+            for (; executed < CYCLES_PER_FRAME; ++executed)
+            {
+                chip8.Cycle();
+            }
+            break;
+        case 1:
+            while (executed < CYCLES_PER_FRAME)
+            {
+                executed += chip8.CycleFused(CYCLES_PER_FRAME - executed);
+            }
+            break;
+        case 2:
+            // Stops are resumed from, as a host would after handling them
+            while (executed < CYCLES_PER_FRAME)
+            {
+                chip8.Run(CYCLES_PER_FRAME - executed, stopMask, &EntryBreakpoint());
+                executed += chip8.runCycles;
+            }
+            break;
+        case 3:
+            return chip8.RunFrame<FastTiming>(CYCLES_PER_FRAME);
+        case 4:
+            return chip8.RunFrame<VipTiming>(VipTiming::CYCLES_PER_FRAME);
+        case 5:
+            for (; executed < CYCLES_PER_FRAME; ++executed)
+            {
+                chip8.CycleHandlers();
+            }
+            break;
+        case 6:
+            for (; executed < CYCLES_PER_FRAME; ++executed)
+            {
+                chip8.CycleTables();
+            }
+            break;
+        default:
+            for (; executed < CYCLES_PER_FRAME; ++executed)
+            {
+                chip8.CycleSwitch();
+            }
+            break;
+    }
+    chip8.UpdateTimers();
+    return executed;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size)
+{
+    if (size < 3)
+    {
+        return 0;
+    }
+
+    CHIP8& chip8 = Machine();
+    chip8.randGen.seed(1);
+
+    if (!chip8.loadROM(data + 3, size - 3, nullptr, static_cast<QuirkProfile>(data[0] & 3u)))
+    {
+        return 0;
+    }
+
+    unsigned int engine = (data[0] >> 2) & 7u;
+    uint32_t stopMask = 0;
+    if (data[0] & 0x20u) stopMask |= CHIP8::STOP_DRAW;
+    if (data[0] & 0x40u) stopMask |= CHIP8::STOP_KEY_WAIT | CHIP8::STOP_SOUND;
+    if (data[0] & 0x80u) stopMask |= CHIP8::STOP_BREAKPOINT;
+
+    // The keypad mask rotates each frame so key-dependent paths vary too
+    uint16_t keys = data[1] | (data[2] << 8u);
+    unsigned int executed = 0;
+
+    // Timed frames run a varying number of instructions, so both limits
+    for (unsigned int frame = 0; frame < FRAMES && executed < INSTRUCTIONS; ++frame)
+    {
+        keys = (uint16_t)((keys << 1) | (keys >> 15));
+        for (unsigned int k = 0; k < 16; ++k)
+        {
+            chip8.keypad[k] = (keys >> k) & 1u;
+        }
+        executed += RunFrame(chip8, engine, stopMask);
+    }
+    return 0;
+}
+
+#ifndef CHIP8_LIBFUZZER
+
+static int RunFile(std::istream& in)
+{
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return LLVMFuzzerTestOneInput(data.data(), data.size());
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc == 3 && std::strcmp(argv[1], "--random") == 0)
+    {
+        // Random bytes are mostly invalid 0/E/F opcodes; drawing their low
+        // byte from the real ones reaches the interesting handlers sooner
+        static const uint8_t low0[] = { 0xE0, 0xEE, 0xC4, 0xFB, 0xFC, 0xFE, 0xFF, 0xEE };
+        static const uint8_t lowE[] = { 0x9E, 0xA1 };
+        static const uint8_t lowF[] = { 0x00, 0x01, 0x02, 0x07, 0x0A, 0x15, 0x18, 0x1E,
+                                        0x29, 0x30, 0x33, 0x3A, 0x55, 0x65, 0x75, 0x85 };
+
+        std::mt19937 random(1);
+        unsigned long count = std::stoul(argv[2]);
+        std::vector<uint8_t> data(3 + 512);
+
+        for (unsigned long n = 0; n < count; ++n)
+        {
+            for (auto& byte : data)
+            {
+                byte = random() & 0xFFu;
+            }
+            for (size_t i = 3; i + 1 < data.size(); i += 2)
+            {
+                switch (data[i] >> 4)
+                {
+                    case 0x0: data[i] = 0x00; data[i + 1] = low0[random() % sizeof(low0)]; break;
+                    case 0xE: data[i + 1] = lowE[random() % sizeof(lowE)]; break;
+                    case 0xF: data[i + 1] = lowF[random() % sizeof(lowF)]; break;
+                }
+            }
+            LLVMFuzzerTestOneInput(data.data(), data.size());
+        }
+        std::printf("%lu random inputs ran clean\n", count);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc == 1)
+    {
+        return RunFile(std::cin);
+    }
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Error: Could not open " << argv[i] << "\n";
+            return EXIT_FAILURE;
+        }
+        RunFile(file);
+    }
+    return EXIT_SUCCESS;
+}
+
+#endif
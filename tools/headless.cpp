@@ -0,0 +1,501 @@
+// chip8-headless: runs a ROM without window, audio or frame pacing
+//
+//   chip8-headless <ROM> [--frames n] [--ipf n] [--timing fast|vip]
+//                  [--quirks vip|chip48|schip|xochip] [--romdb file]
+//                  [--engine fused|lut|handlers|tables|switch] [--seed n] [--trace file]
+//                  [--movie file] [--dump]
+//   chip8-headless --regress <golden file> [--update]
+//
+// Reports how many times faster than real time the frames ran and a hash
+// of the final screen; --dump also prints the screen as text. --movie
+// plays recorded input (movie.h), e.g. from the frontend's --record, which
+// with the same quirks, speed and seed replays that session.
+//
+// --regress plays each ROM in the golden file with its input movie under
+// every engine and compares framebuffer hashes, chained over every frame,
+// with the stored ones at each checkpoint. --update rewrites the stored
+// hashes from the fused engine, once all engines agree. The file holds
+//
+//   rom <ROM> <quirks> <ipf> <frames> <interval> <movie or ->
+//
+// lines, each followed by its '<frame> <hash>' checkpoints; paths are
+// relative to the file and '-' plays the default pseudo-random movie.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "chip8.h"
+#include "movie.h"
+#include "timing.h"
+#include "trace.h"
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr int DEFAULT_CYCLES_PER_FRAME = 11;
+
+static char const* const ENGINES[] = { "fused", "lut", "handlers", "tables", "switch" };
+
+// One frame of fast timing on the named engine; returns the instructions
+// executed. The unfused engines go one instruction at a time, for comparing
+// throughput and results.
+static uint64_t RunFastFrame(CHIP8& chip8, char const* engine, int cyclesPerFrame)
+{
+    if (std::strcmp(engine, "fused") == 0)
+    {
+        return chip8.RunFrame<FastTiming>(cyclesPerFrame);
+    }
+
+    for (int cycle = 0; cycle < cyclesPerFrame; ++cycle)
+    {
+        switch (engine[0])
+        {
+            case 'l': chip8.Cycle(); break;
+            case 'h': chip8.CycleHandlers(); break;
+            case 't': chip8.CycleTables(); break;
+            default: chip8.CycleSwitch(); break;
+        }
+    }
+    chip8.UpdateTimers();
+    return cyclesPerFrame;
+}
+
+using Checkpoints = std::vector<std::pair<unsigned long, uint64_t>>;
+
+struct Regression
+{
+    std::string rom;
+    std::string movie;      // "-" for DefaultMovie
+    QuirkProfile profile;
+    int cyclesPerFrame;
+    unsigned long frames;
+    unsigned long interval;
+    size_t line;            // of the rom line, to write checkpoints after
+    Checkpoints golden;
+};
+
+// Keeps every line but the checkpoints, so --update can write the file
+// back with its comments
+static bool LoadGolden(char const* filename, std::vector<Regression>& regressions, std::vector<std::string>& lines)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        std::cerr << "Error: Could not open " << filename << "\n";
+        return false;
+    }
+
+    std::string line;
+    for (size_t number = 1; std::getline(file, line); ++number)
+    {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string word;
+
+        if (!(fields >> word))
+        {
+            lines.push_back(line);
+            continue;
+        }
+
+        if (word == "rom")
+        {
+            Regression regression;
+            std::string quirks;
+
+            if (!(fields >> regression.rom >> quirks >> regression.cyclesPerFrame >> regression.frames
+                    >> regression.interval >> regression.movie)
+                || !ParseQuirkProfile(quirks.c_str(), regression.profile)
+                || regression.cyclesPerFrame <= 0 || regression.interval == 0)
+            {
+                std::cerr << "Error: " << filename << ":" << number << ": bad rom line\n";
+                return false;
+            }
+            regression.line = lines.size();
+            regressions.push_back(regression);
+            lines.push_back(line);
+            continue;
+        }
+
+        std::istringstream checkpoint(line.substr(0, line.find('#')));
+        unsigned long frame;
+        unsigned long long hash;
+        if (regressions.empty() || !(checkpoint >> frame >> std::hex >> hash))
+        {
+            std::cerr << "Error: " << filename << ":" << number << ": expected a rom line or '<frame> <hash>'\n";
+            return false;
+        }
+        regressions.back().golden.push_back({frame, hash});
+    }
+    return true;
+}
+
+// Chains the framebuffer hash over every frame, so a difference on any
+// frame shows at the next checkpoint, and records it every interval
+// frames and after the last one
+static Checkpoints RunRegression(Regression const& regression, std::vector<uint8_t> const& rom,
+    std::vector<MovieEntry> const& movie, char const* engine)
+{
+    std::unique_ptr<CHIP8> chip8(new CHIP8);   // 64 KB of memory, keep it off the stack
+    chip8->loadROM(rom.data(), rom.size(), nullptr, regression.profile);
+    chip8->randGen.seed(1);
+
+    Checkpoints checkpoints;
+    uint64_t hash = chip8->FramebufferHash();
+    size_t next = 0;
+
+    for (unsigned long frame = 0; frame < regression.frames; ++frame)
+    {
+        next = ApplyMovie(movie, next, frame, chip8->keypad);
+        RunFastFrame(*chip8, engine, regression.cyclesPerFrame);
+        hash = chip8->FramebufferHash(hash);
+
+        if ((frame + 1) % regression.interval == 0 || frame + 1 == regression.frames)
+        {
+            checkpoints.push_back({frame + 1, hash});
+        }
+    }
+    return checkpoints;
+}
+
+static int Regress(char const* goldenFilename, bool update)
+{
+    std::vector<Regression> regressions;
+    std::vector<std::string> lines;
+    if (!LoadGolden(goldenFilename, regressions, lines))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::filesystem::path directory = std::filesystem::path(goldenFilename).parent_path();
+    unsigned int failures = 0;
+    auto start = Clock::now();
+
+    for (Regression& regression : regressions)
+    {
+        std::string romPath = (directory / regression.rom).string();
+        std::ifstream file(romPath, std::ios::binary);
+        std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (!file.is_open() || rom.empty())
+        {
+            std::cerr << "Error: Could not load ROM " << romPath << "\n";
+            return EXIT_FAILURE;
+        }
+
+        std::vector<MovieEntry> movie;
+        if (regression.movie == "-")
+        {
+            movie = DefaultMovie(regression.frames);
+        }
+        else if (!LoadMovie((directory / regression.movie).string().c_str(), movie))
+        {
+            return EXIT_FAILURE;
+        }
+
+        if (update)
+        {
+            regression.golden = RunRegression(regression, rom, movie, ENGINES[0]);
+        }
+        else if (regression.golden.empty())
+        {
+            std::printf("FAIL  %s: no golden hashes, run with --update\n", regression.rom.c_str());
+            ++failures;
+            continue;
+        }
+
+        for (char const* engine : ENGINES)
+        {
+            Checkpoints checkpoints = RunRegression(regression, rom, movie, engine);
+            size_t i = 0;
+            while (i < checkpoints.size() && i < regression.golden.size() && checkpoints[i] == regression.golden[i])
+            {
+                ++i;
+            }
+
+            if (i == checkpoints.size() && i == regression.golden.size())
+            {
+                std::printf("OK    %s %s: %lu frames, %zu checkpoints\n",
+                    regression.rom.c_str(), engine, regression.frames, checkpoints.size());
+                continue;
+            }
+
+            ++failures;
+            unsigned long good = i ? checkpoints[i - 1].first : 0;
+            if (i < checkpoints.size() && i < regression.golden.size() && checkpoints[i].first == regression.golden[i].first)
+            {
+                std::printf("FAIL  %s %s: screen differs between frames %lu and %lu, hash %016llx, golden %016llx\n",
+                    regression.rom.c_str(), engine, good, checkpoints[i].first,
+                    (unsigned long long)checkpoints[i].second, (unsigned long long)regression.golden[i].second);
+            }
+            else
+            {
+                std::printf("FAIL  %s %s: checkpoints after frame %lu do not match the golden frames\n",
+                    regression.rom.c_str(), engine, good);
+            }
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("%zu ROMs, %u failures in %.3f s\n", regressions.size(), failures, seconds);
+
+    if (failures)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (update)
+    {
+        std::ofstream out(goldenFilename);
+        size_t r = 0;
+        for (size_t i = 0; i < lines.size(); ++i)
+        {
+            out << lines[i] << "\n";
+            if (r < regressions.size() && regressions[r].line == i)
+            {
+                for (auto const& checkpoint : regressions[r].golden)
+                {
+                    char text[40];
+                    std::snprintf(text, sizeof(text), "%lu %016llx\n",
+                        checkpoint.first, (unsigned long long)checkpoint.second);
+                    out << text;
+                }
+                ++r;
+            }
+        }
+        if (!out)
+        {
+            std::cerr << "Error: Could not write " << goldenFilename << "\n";
+            return EXIT_FAILURE;
+        }
+        std::printf("Updated %s\n", goldenFilename);
+    }
+    return EXIT_SUCCESS;
+}
+
+static void DumpScreen(CHIP8 const& chip8)
+{
+    for (unsigned int y = 0; y < chip8.Height(); ++y)
+    {
+        std::string row;
+        for (unsigned int x = 0; x < chip8.Width(); ++x)
+        {
+            unsigned int shift = 63 - (x & 63);
+            unsigned int colour = ((chip8.video[0][y][x >> 6] >> shift) & 1u)
+                | (((chip8.video[1][y][x >> 6] >> shift) & 1u) << 1);
+            row += " #+*"[colour];
+        }
+        std::printf("%s\n", row.c_str());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc >= 3 && std::strcmp(argv[1], "--regress") == 0
+        && (argc == 3 || (argc == 4 && std::strcmp(argv[3], "--update") == 0)))
+    {
+        return Regress(argv[2], argc == 4);
+    }
+
+    if (argc < 2 || argv[1][0] == '-')
+    {
+        std::cerr << "Usage: " << argv[0] << " <ROM> [--frames <n>] [--ipf <cycles per frame>]"
+            " [--timing fast|vip] [--quirks vip|chip48|schip|xochip] [--romdb <file>]"
+            " [--engine fused|lut|handlers|tables|switch] [--seed <n>] [--trace <file>] [--movie <file>] [--dump]\n"
+            "       " << argv[0] << " --regress <golden file> [--update]\n";
+        return EXIT_FAILURE;
+    }
+
+    char const* romFilename = argv[1];
+    char const* romdbFilename = "romdb.bin";
+    char const* quirkName = nullptr;
+    char const* traceFilename = nullptr;
+    char const* movieFilename = nullptr;
+    unsigned long frames = 600;
+    int cyclesPerFrame = 0;
+    bool vipTiming = false;
+    char const* engine = "fused";
+    bool dump = false;
+    unsigned long seed = 1;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--dump") == 0)
+        {
+            dump = true;
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            std::cerr << "Error: Missing value for " << argv[i] << "\n";
+            return EXIT_FAILURE;
+        }
+
+        char const* value = argv[++i];
+        if (std::strcmp(argv[i - 1], "--frames") == 0)
+        {
+            frames = std::stoul(value);
+        }
+        else if (std::strcmp(argv[i - 1], "--ipf") == 0)
+        {
+            cyclesPerFrame = std::stoi(value);
+        }
+        else if (std::strcmp(argv[i - 1], "--timing") == 0)
+        {
+            if (std::strcmp(value, "vip") != 0 && std::strcmp(value, "fast") != 0)
+            {
+                std::cerr << "Error: Unknown timing model " << value << "\n";
+                return EXIT_FAILURE;
+            }
+            vipTiming = std::strcmp(value, "vip") == 0;
+        }
+        else if (std::strcmp(argv[i - 1], "--quirks") == 0)
+        {
+            quirkName = value;
+        }
+        else if (std::strcmp(argv[i - 1], "--romdb") == 0)
+        {
+            romdbFilename = value;
+        }
+        else if (std::strcmp(argv[i - 1], "--engine") == 0)
+        {
+            if (std::strcmp(value, "fused") != 0 && std::strcmp(value, "lut") != 0 && std::strcmp(value, "handlers") != 0
+                && std::strcmp(value, "tables") != 0 && std::strcmp(value, "switch") != 0)
+            {
+                std::cerr << "Error: Unknown engine " << value << "\n";
+                return EXIT_FAILURE;
+            }
+            engine = value;
+        }
+        else if (std::strcmp(argv[i - 1], "--trace") == 0)
+        {
+            traceFilename = value;
+        }
+        else if (std::strcmp(argv[i - 1], "--movie") == 0)
+        {
+            movieFilename = value;
+        }
+        else if (std::strcmp(argv[i - 1], "--seed") == 0)
+        {
+            seed = std::stoul(value);
+        }
+        else
+        {
+            std::cerr << "Error: Unknown option " << argv[i - 1] << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    RomDatabase romdb;
+    romdb.Open(romdbFilename);
+
+    CHIP8 chip8;
+    if (!chip8.loadROM(romFilename, &romdb))
+    {
+        std::cerr << "Error: Could not load ROM " << romFilename << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // Fixed seed so Cxkk, and with it the final screen, is reproducible
+    chip8.randGen.seed(seed);
+
+    if (quirkName)
+    {
+        QuirkProfile profile;
+        if (!ParseQuirkProfile(quirkName, profile))
+        {
+            std::cerr << "Error: Unknown quirk profile " << quirkName << "\n";
+            return EXIT_FAILURE;
+        }
+        chip8.SetQuirks(profile);
+    }
+
+    if (!cyclesPerFrame && chip8.romInfo)
+    {
+        cyclesPerFrame = chip8.romInfo->cyclesPerFrame;
+    }
+    if (cyclesPerFrame <= 0)
+    {
+        cyclesPerFrame = DEFAULT_CYCLES_PER_FRAME;
+    }
+
+    if (vipTiming && std::strcmp(engine, "fused") != 0)
+    {
+        std::cerr << "Error: --engine " << engine << " runs with fast timing only\n";
+        return EXIT_FAILURE;
+    }
+
+    TraceRecorder trace;
+    if (traceFilename)
+    {
+        if (vipTiming)
+        {
+            std::cerr << "Error: --trace runs with fast timing only\n";
+            return EXIT_FAILURE;
+        }
+        if (!trace.Open(traceFilename, chip8.romHash))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<MovieEntry> movie;
+    if (movieFilename && !LoadMovie(movieFilename, movie))
+    {
+        return EXIT_FAILURE;
+    }
+
+    uint64_t instructions = 0;
+    size_t nextInput = 0;
+    auto start = Clock::now();
+
+    for (unsigned long frame = 0; frame < frames; ++frame)
+    {
+        nextInput = ApplyMovie(movie, nextInput, frame, chip8.keypad);
+
+        if (trace.IsOpen())
+        {
+            for (int cycle = 0; cycle < cyclesPerFrame; ++cycle)
+            {
+                uint16_t pc = chip8.Pc;
+                uint16_t opcode = (chip8.memory[pc] << 8u) | chip8.memory[(pc + 1) & chip8.addressMask];
+
+                chip8.Cycle();
+                trace.Record(pc, opcode, chip8);
+            }
+            chip8.UpdateTimers();
+            instructions += cyclesPerFrame;
+        }
+        else if (vipTiming)
+        {
+            instructions += chip8.RunFrame<VipTiming>(VipTiming::CYCLES_PER_FRAME);
+        }
+        else
+        {
+            instructions += RunFastFrame(chip8, engine, cyclesPerFrame);
+        }
+    }
+    trace.Close();
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double emulated = frames / 60.0;
+
+    if (dump)
+    {
+        DumpScreen(chip8);
+    }
+
+    std::printf("%lu frames, %llu instructions (%s engine, %s timing), %.3f s emulated in %.3f s: %.0fx real time\n",
+        frames, (unsigned long long)instructions, engine, vipTiming ? "vip" : "fast",
+        emulated, seconds, seconds > 0 ? emulated / seconds : 0.0);
+    std::printf("screen %016llx\n", (unsigned long long)chip8.FramebufferHash());
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+// chip8-romdb: builds the binary ROM database read by the emulator
+//
+//   chip8-romdb hash <ROM>...            print database keys for ROM files
+//   chip8-romdb build <romdb.txt> <romdb.bin>
+//
+// romdb.txt holds one ROM per line, '#' starts a comment:
+//   <hash> <vip|chip48|schip|xochip> <cycles per frame> <layout|-> <title>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "quirks.h"
+#include "romdb.h"
+
+static int HashRoms(int count, char* files[])
+{
+    for (int i = 0; i < count; ++i)
+    {
+        std::ifstream file(files[i], std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Error: Could not open " << files[i] << "\n";
+            return EXIT_FAILURE;
+        }
+
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::printf("%016llx  %s\n", (unsigned long long)RomDatabase::Hash(data.data(), data.size()), files[i]);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int Build(const char* input, const char* output)
+{
+    std::ifstream in(input);
+    if (!in.is_open())
+    {
+        std::cerr << "Error: Could not open " << input << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<RomInfo> records;
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(in, line))
+    {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream fields(line);
+        std::string hash, profileName, layout, title;
+        unsigned int cyclesPerFrame = 0;
+
+        if (!(fields >> hash))
+        {
+            continue;
+        }
+
+        QuirkProfile profile;
+        fields >> profileName >> cyclesPerFrame >> layout;
+        std::getline(fields >> std::ws, title);
+
+        if (!fields.eof() || !ParseQuirkProfile(profileName.c_str(), profile)
+            || cyclesPerFrame == 0 || cyclesPerFrame > 0xFFFF || title.empty())
+        {
+            std::cerr << "Error: " << input << ":" << lineNumber
+                << ": expected '<hash> <profile> <cycles per frame> <layout|-> <title>'\n";
+            return EXIT_FAILURE;
+        }
+
+        RomInfo info{};
+        info.hash = std::strtoull(hash.c_str(), nullptr, 16);
+        info.cyclesPerFrame = (uint16_t)cyclesPerFrame;
+        info.profile = (uint8_t)profile;
+        std::strncpy(info.title, title.c_str(), sizeof(info.title) - 1);
+        if (layout != "-")
+        {
+            std::strncpy(info.layout, layout.c_str(), sizeof(info.layout) - 1);
+        }
+        records.push_back(info);
+    }
+
+    std::sort(records.begin(), records.end(),
+        [](RomInfo const& a, RomInfo const& b) { return a.hash < b.hash; });
+
+    RomDbHeader header{{'C', '8', 'D', 'B'}, RomDatabase::VERSION, (uint32_t)records.size(), 0};
+
+    std::ofstream out(output, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(RomInfo));
+
+    if (!out)
+    {
+        std::cerr << "Error: Could not write " << output << "\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << records.size() << " ROMs written to " << output << "\n";
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc >= 3 && std::strcmp(argv[1], "hash") == 0)
+    {
+        return HashRoms(argc - 2, argv + 2);
+    }
+    if (argc == 4 && std::strcmp(argv[1], "build") == 0)
+    {
+        return Build(argv[2], argv[3]);
+    }
+
+    std::cerr << "Usage: " << argv[0] << " hash <ROM>...\n"
+        << "       " << argv[0] << " build <romdb.txt> <romdb.bin>\n";
+    return EXIT_FAILURE;
+}
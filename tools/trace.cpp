@@ -0,0 +1,277 @@
+// chip8-trace: reads execution traces written with --trace
+//
+//   chip8-trace text <trace>               print every record as text
+//   chip8-trace diff <trace a> <trace b>   find the first divergence
+//   chip8-trace profile <trace> [n]        n most executed opcodes, and
+//                                          straight-line pairs and triples
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "decode.h"
+#include "trace.h"
+
+// Records read per fread
+static constexpr size_t CHUNK = 1 << 16;
+
+// Number of matching records shown before a divergence
+static constexpr size_t CONTEXT = 8;
+
+class TraceFile
+{
+    public:
+        ~TraceFile()
+        {
+            if (file)
+            {
+                std::fclose(file);
+            }
+        }
+
+        bool Open(const char* filename)
+        {
+            file = std::fopen(filename, "rb");
+            if (!file)
+            {
+                std::cerr << "Error: Could not open " << filename << "\n";
+                return false;
+            }
+
+            if (std::fread(&header, sizeof(header), 1, file) != 1
+                || std::memcmp(header.magic, "C8TR", 4) != 0
+                || header.version != TraceRecorder::VERSION)
+            {
+                std::cerr << "Error: " << filename << " is not a version "
+                    << TraceRecorder::VERSION << " trace\n";
+                return false;
+            }
+            return true;
+        }
+
+        bool Next(TraceRecord& record)
+        {
+            if (position == buffer.size())
+            {
+                buffer.resize(CHUNK);
+                buffer.resize(std::fread(buffer.data(), sizeof(TraceRecord), CHUNK, file));
+                position = 0;
+
+                if (buffer.empty())
+                {
+                    return false;
+                }
+            }
+            record = buffer[position++];
+            return true;
+        }
+
+        TraceHeader header{};
+
+    private:
+        FILE* file{};
+        std::vector<TraceRecord> buffer;
+        size_t position{};
+};
+
+static void Print(uint64_t number, TraceRecord const& record, char const* prefix = "")
+{
+    std::printf("%s%10llu  %04X  %04X  I=%04X  V%X=%02X  VF=%02X\n", prefix,
+        (unsigned long long)number, record.pc, record.opcode, record.index,
+        (record.opcode & 0x0F00u) >> 8u, record.vx, record.vf);
+}
+
+static int Text(const char* filename)
+{
+    TraceFile trace;
+    if (!trace.Open(filename))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::printf("# ROM %016llx\n", (unsigned long long)trace.header.romHash);
+
+    TraceRecord record;
+    for (uint64_t number = 0; trace.Next(record); ++number)
+    {
+        Print(number, record);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int Diff(const char* filenameA, const char* filenameB)
+{
+    TraceFile a, b;
+    if (!a.Open(filenameA) || !b.Open(filenameB))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (a.header.romHash != b.header.romHash)
+    {
+        std::printf("Warning: traces are of different ROMs\n");
+    }
+
+    // Ring of the last matching records for context
+    TraceRecord history[CONTEXT];
+    TraceRecord recordA, recordB;
+    uint64_t number = 0;
+
+    for (;; ++number)
+    {
+        bool hasA = a.Next(recordA);
+        bool hasB = b.Next(recordB);
+
+        if (!hasA && !hasB)
+        {
+            std::printf("Traces are identical, %llu records\n", (unsigned long long)number);
+            return EXIT_SUCCESS;
+        }
+
+        if (hasA != hasB || std::memcmp(&recordA, &recordB, sizeof(TraceRecord)) != 0)
+        {
+            std::printf("First divergence at record %llu\n", (unsigned long long)number);
+
+            uint64_t first = number > CONTEXT ? number - CONTEXT : 0;
+            for (uint64_t i = first; i < number; ++i)
+            {
+                Print(i, history[i % CONTEXT], "  ");
+            }
+
+            if (hasA)
+            {
+                Print(number, recordA, "a ");
+            }
+            else
+            {
+                std::printf("a %10llu  end of trace\n", (unsigned long long)number);
+            }
+
+            if (hasB)
+            {
+                Print(number, recordB, "b ");
+            }
+            else
+            {
+                std::printf("b %10llu  end of trace\n", (unsigned long long)number);
+            }
+            return EXIT_FAILURE;
+        }
+
+        history[number % CONTEXT] = recordA;
+    }
+}
+
+// Prints the n largest counts; name turns an index back into text
+template <typename Name>
+static void PrintTop(char const* title, std::vector<uint64_t> const& counts, uint64_t total, size_t n, Name name)
+{
+    std::vector<size_t> order;
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        if (counts[i])
+        {
+            order.push_back(i);
+        }
+    }
+    n = std::min(n, order.size());
+    std::partial_sort(order.begin(), order.begin() + n, order.end(),
+        [&](size_t a, size_t b) { return counts[a] > counts[b]; });
+
+    std::printf("\n%s\n", title);
+    for (size_t i = 0; i < n; ++i)
+    {
+        std::printf("  %-20s %12llu  %5.2f%%\n", name(order[i]).c_str(),
+            (unsigned long long)counts[order[i]], 100.0 * counts[order[i]] / total);
+    }
+}
+
+// Opcode frequencies plus pairs and triples that ran straight through, i.e.
+// each record's Pc follows the previous instruction. Those are the
+// sequences a superinstruction can replace.
+static int Profile(const char* filename, size_t n)
+{
+    TraceFile trace;
+    if (!trace.Open(filename))
+    {
+        return EXIT_FAILURE;
+    }
+
+    constexpr size_t IDS = (size_t)OpId::Count;
+    std::vector<uint64_t> singles(IDS), pairs(IDS * IDS), triples(IDS * IDS * IDS);
+    uint64_t total = 0;
+
+    // Ids of the previous two records, or IDS where the run was broken
+    size_t previous = IDS, before = IDS;
+    uint16_t expected = 0;
+
+    TraceRecord record;
+    while (trace.Next(record))
+    {
+        OpId op = DECODE_LUT.ids[record.opcode];
+        size_t id = (size_t)op;
+
+        if (record.pc != expected)
+        {
+            previous = before = IDS;
+        }
+
+        ++singles[id];
+        if (previous < IDS)
+        {
+            ++pairs[previous * IDS + id];
+            if (before < IDS)
+            {
+                ++triples[(before * IDS + previous) * IDS + id];
+            }
+        }
+        ++total;
+
+        before = previous;
+        previous = id;
+        expected = (uint16_t)(record.pc + InstructionLength(op));
+    }
+
+    if (total == 0)
+    {
+        std::printf("Empty trace\n");
+        return EXIT_SUCCESS;
+    }
+
+    std::printf("# ROM %016llx, %llu instructions\n",
+        (unsigned long long)trace.header.romHash, (unsigned long long)total);
+
+    PrintTop("opcodes", singles, total, n,
+        [](size_t i) { return std::string(OpName((OpId)i)); });
+    PrintTop("pairs", pairs, total, n,
+        [](size_t i) { return std::string(OpName((OpId)(i / IDS))) + " " + OpName((OpId)(i % IDS)); });
+    PrintTop("triples", triples, total, n,
+        [](size_t i) {
+            return std::string(OpName((OpId)(i / (IDS * IDS)))) + " " + OpName((OpId)(i / IDS % IDS))
+                + " " + OpName((OpId)(i % IDS));
+        });
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc == 3 && std::strcmp(argv[1], "text") == 0)
+    {
+        return Text(argv[2]);
+    }
+    if (argc == 4 && std::strcmp(argv[1], "diff") == 0)
+    {
+        return Diff(argv[2], argv[3]);
+    }
+    if ((argc == 3 || argc == 4) && std::strcmp(argv[1], "profile") == 0)
+    {
+        return Profile(argv[2], argc == 4 ? std::stoul(argv[3]) : 12);
+    }
+
+    std::cerr << "Usage: " << argv[0] << " text <trace>\n"
+        << "       " << argv[0] << " diff <trace a> <trace b>\n"
+        << "       " << argv[0] << " profile <trace> [n]\n";
+    return EXIT_FAILURE;
+}